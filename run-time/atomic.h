@@ -0,0 +1,88 @@
+/*
+ * This file contains atomic operations and memory barriers used by
+ * the lock-free parts of the run-time (e.g. the method cache).
+ *
+ * Just like the retain count of MRObject, they are currently
+ * implemented using the GCC builtins, which are supported
+ * by Clang as well. If your compiler doesn't support them,
+ * this is the only place that needs to be ported.
+ */
+
+#ifndef OBJC_ATOMIC_H_
+#define OBJC_ATOMIC_H_
+
+#include "types.h" /* For BOOL */
+
+/**
+ * Loads the value stored at ptr. No reads or writes that follow
+ * in the current thread can be reordered before this load.
+ */
+#define objc_atomic_load_acquire(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+
+/**
+ * Loads the value stored at ptr without any ordering constraints.
+ * The load itself is atomic, though.
+ */
+#define objc_atomic_load_relaxed(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+
+/**
+ * Stores value at ptr. No reads or writes that precede
+ * in the current thread can be reordered after this store.
+ *
+ * Use this to publish a structure that has been populated
+ * beforehand to lock-free readers.
+ */
+#define objc_atomic_store_release(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+
+/**
+ * Stores value at ptr without any ordering constraints.
+ */
+#define objc_atomic_store_relaxed(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELAXED)
+
+/**
+ * Atomically stores value at ptr and returns the value previously
+ * stored there. This is a full memory barrier.
+ */
+#define objc_atomic_exchange(ptr, value) __atomic_exchange_n((ptr), (value), __ATOMIC_SEQ_CST)
+
+/**
+ * Full memory barrier - no reads or writes can be reordered
+ * across it in either direction. Unlike acquire and release,
+ * this also orders a store before a subsequent load.
+ */
+#define objc_atomic_full_barrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/**
+ * Compiler barrier - the compiler doesn't reorder any reads or writes
+ * across it, the CPU still may. Only useful when another thread issues
+ * a barrier on behalf of the current one (see reclaim.c).
+ */
+#define objc_atomic_compiler_barrier() __atomic_signal_fence(__ATOMIC_SEQ_CST)
+
+/**
+ * Acquire barrier - no reads that precede it can be reordered
+ * with reads or writes that follow it. Used by sequence-counter
+ * readers before re-reading the counter.
+ */
+#define objc_atomic_acquire_barrier() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+
+/**
+ * Atomically increments the value stored at ptr and returns
+ * the new value. This is a full memory barrier.
+ */
+#define objc_atomic_increment(ptr) __sync_add_and_fetch((ptr), 1)
+
+/**
+ * Atomically adds value to the value stored at ptr and returns
+ * the new value. This is a full memory barrier.
+ */
+#define objc_atomic_add(ptr, value) __sync_add_and_fetch((ptr), (value))
+
+/**
+ * If the value stored at ptr equals to expected, desired is stored
+ * instead and YES is returned. Otherwise NO is returned. This is
+ * a full memory barrier.
+ */
+#define objc_atomic_compare_and_swap(ptr, expected, desired) ((BOOL)__sync_bool_compare_and_swap((ptr), (expected), (desired)))
+
+#endif /* OBJC_ATOMIC_H_ */
@@ -0,0 +1,139 @@
+/*
+ * Implementation of the call-site caches.
+ *
+ * The cache is guarded by a sequence counter. A writer makes the
+ * counter odd, updates the entries and makes it even again, readers
+ * retry the regular lookup if the counter has changed meanwhile. This
+ * way the readers don't write anything, so that a cache shared by many
+ * threads stays in their CPU caches. Writers never wait - if the cache
+ * is being updated by another thread, the update is simply skipped.
+ *
+ * The entries are valid only in the dispatch generation they have
+ * been filled in. The run-time increments the generation on each
+ * mutation that may change the result of a lookup, which invalidates
+ * all call sites at once, without the need to keep track of them.
+ */
+
+#include "callsite.h"
+#include "class.h"
+#include "private.h"
+#include "os.h"
+#include "atomic.h"
+
+/**
+ * The class cannot be used as the key on its own - a class object
+ * has its isa pointing to itself, just like its instances do. Class
+ * methods are hence cached under a tagged class pointer.
+ */
+#define CALL_SITE_KEY(obj) (OBJC_OBJ_IS_CLASS(obj) ? (Class)((unsigned long)(obj) | 1) : (obj)->isa)
+
+/**
+ * Looks up the IMP for key in the cache. Returns NULL if the entries
+ * aren't valid in generation, or if key isn't cached. Sets *megamorphic
+ * if the site is known to be megamorphic.
+ */
+OBJC_INLINE IMP _call_site_cache_fetch(objc_call_site_cache *cache, Class key, unsigned int generation, BOOL *megamorphic) OBJC_ALWAYS_INLINE;
+OBJC_INLINE IMP _call_site_cache_fetch(objc_call_site_cache *cache, Class key, unsigned int generation, BOOL *megamorphic){
+	unsigned int sequence = objc_atomic_load_acquire(&cache->sequence);
+	unsigned int count;
+	unsigned int index;
+	IMP imp = NULL;
+	
+	if ((sequence & 1) != 0 || objc_atomic_load_relaxed(&cache->generation) != generation){
+		/* Being updated, or stale. */
+		return NULL;
+	}
+	
+	count = objc_atomic_load_relaxed(&cache->count);
+	if (count == OBJC_CALL_SITE_MEGAMORPHIC){
+		*megamorphic = YES;
+		return NULL;
+	}
+	
+	for (index = 0; index < count && index < OBJC_CALL_SITE_CACHE_SIZE; ++index){
+		if (objc_atomic_load_relaxed(&cache->entries[index].isa) == key){
+			imp = objc_atomic_load_relaxed(&cache->entries[index].implementation);
+			break;
+		}
+	}
+	
+	/* The entries must have been read before the sequence is checked again. */
+	objc_atomic_acquire_barrier();
+	if (objc_atomic_load_relaxed(&cache->sequence) != sequence){
+		return NULL;
+	}
+	return imp;
+}
+
+/**
+ * Adds key -> imp to the cache, found in generation. If the cache is full,
+ * the site becomes megamorphic. Skipped if someone else is updating the cache.
+ */
+OBJC_INLINE void _call_site_cache_insert(objc_call_site_cache *cache, Class key, IMP imp, unsigned int generation) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _call_site_cache_insert(objc_call_site_cache *cache, Class key, IMP imp, unsigned int generation){
+	unsigned int sequence = objc_atomic_load_relaxed(&cache->sequence);
+	unsigned int count;
+	
+	if ((sequence & 1) != 0 || !objc_atomic_compare_and_swap(&cache->sequence, sequence, sequence + 1)){
+		return;
+	}
+	
+	count = cache->count;
+	if (cache->generation != generation){
+		/* Filled in another generation, start over. */
+		objc_atomic_store_relaxed(&cache->generation, generation);
+		count = 0;
+	}
+	
+	if (count != OBJC_CALL_SITE_MEGAMORPHIC){
+		unsigned int index;
+		for (index = 0; index < count; ++index){
+			if (cache->entries[index].isa == key){
+				/* Another thread has been faster. */
+				objc_atomic_store_release(&cache->sequence, sequence + 2);
+				return;
+			}
+		}
+	}
+	
+	if (count < OBJC_CALL_SITE_CACHE_SIZE){
+		objc_atomic_store_relaxed(&cache->entries[count].isa, key);
+		objc_atomic_store_relaxed(&cache->entries[count].implementation, imp);
+		++count;
+	}else{
+		count = OBJC_CALL_SITE_MEGAMORPHIC;
+	}
+	objc_atomic_store_relaxed(&cache->count, count);
+	
+	objc_atomic_store_release(&cache->sequence, sequence + 2);
+}
+
+IMP objc_call_site_lookup_impl(objc_call_site_cache *cache, id obj, SEL selector){
+	unsigned int generation;
+	BOOL megamorphic = NO;
+	Class key;
+	IMP imp;
+	
+	if (obj == nil || cache == NULL){
+		return objc_object_lookup_impl(obj, selector);
+	}
+	
+	/* Must be read before the lookup, so that a flush during the lookup is noticed. */
+	generation = objc_atomic_load_acquire(&objc_dispatch_generation);
+	key = CALL_SITE_KEY(obj);
+	
+	imp = _call_site_cache_fetch(cache, key, generation, &megamorphic);
+	if (imp != NULL){
+		return imp;
+	}
+	
+	imp = objc_object_lookup_impl(obj, selector);
+	if (!megamorphic){
+		_call_site_cache_insert(cache, key, imp, generation);
+	}
+	return imp;
+}
+
+unsigned int objc_dispatch_get_generation(void){
+	return objc_atomic_load_acquire(&objc_dispatch_generation);
+}
@@ -0,0 +1,51 @@
+/*
+ * This header file contains declarations of functions
+ * that deal with call-site (inline) caches.
+ *
+ * A call-site cache remembers the IMPs of the last few receiver
+ * classes seen at a single call site, so that a call site that sends
+ * the same message to objects of several classes doesn't need to
+ * look the method up each time the receiver's class changes.
+ */
+
+#ifndef OBJC_CALLSITE_H_
+#define OBJC_CALLSITE_H_
+
+#include "types.h"
+
+/**
+ * Value of objc_call_site_cache.count once the site has seen
+ * more than OBJC_CALL_SITE_CACHE_SIZE classes. Such a site simply
+ * uses the regular lookup from then on, until the cache is invalidated.
+ */
+#define OBJC_CALL_SITE_MEGAMORPHIC ((unsigned int)-1)
+
+/**
+ * Returns the IMP for selector to be called on obj, just like
+ * objc_object_lookup_impl, trying the call-site cache first.
+ *
+ * The cache is typically a static variable at the call site:
+ *
+ *	static objc_call_site_cache cache;
+ *	IMP imp = objc_call_site_lookup_impl(&cache, obj, selector);
+ *
+ * The cache must always be used with the same selector. It may
+ * be shared by multiple threads - readers never write into it
+ * and updates are atomic. The run-time invalidates all call-site
+ * caches by moving on to the next dispatch generation.
+ */
+extern IMP objc_call_site_lookup_impl(objc_call_site_cache *cache, id obj, SEL selector);
+
+/**
+ * Returns the current dispatch generation. The generation changes
+ * whenever the result of a lookup may change - a method gets added
+ * or replaced, a category gets attached, caches get flushed, or
+ * the class of an object gets changed. Nothing else (e.g. messaging
+ * nil or forwarding) changes it.
+ *
+ * A custom inline cache should read the generation *before* the lookup
+ * and consider the IMP valid as long as the generation stays the same.
+ */
+extern unsigned int objc_dispatch_get_generation(void);
+
+#endif /* OBJC_CALLSITE_H_ */
@@ -8,6 +8,26 @@
 #include "utils.h"
 #include "selector.h"
 #include "method.h"
+#include "atomic.h"
+#include "reclaim.h"
+#include "intern.h"
+
+/**
+ * Scanning selectors using SIMD instructions, see _method_table_scan.
+ * Define as 0 to use the portable scan only.
+ */
+#if !defined(OBJC_USES_SIMD_SELECTOR_SCAN)
+	#define OBJC_USES_SIMD_SELECTOR_SCAN 1
+#endif
+
+#if OBJC_USES_SIMD_SELECTOR_SCAN && defined(__AVX2__)
+	#include <immintrin.h>
+#elif OBJC_USES_SIMD_SELECTOR_SCAN && defined(__SSE2__)
+	#include <emmintrin.h>
+#else
+	#undef OBJC_USES_SIMD_SELECTOR_SCAN
+	#define OBJC_USES_SIMD_SELECTOR_SCAN 0
+#endif
 
 /**
  * A class holder - all classes that get registered
@@ -34,6 +54,26 @@ objc_class_extension *class_extensions;
  */
 objc_rw_lock objc_runtime_lock;
 
+/**
+ * YES once any class uses eager dispatch. Until then, flushing
+ * caches doesn't need to look for dispatch tables to rebuild.
+ */
+static BOOL objc_eager_dispatch_in_use = NO;
+
+/**
+ * YES if any of the class extensions implements object_has_managed_lifetime,
+ * so that reference counting classes don't need to walk the extensions.
+ */
+static BOOL objc_extensions_manage_lifetime = NO;
+
+/**
+ * Dispatch generation - incremented whenever the result of a lookup
+ * may change (a method gets added or replaced, caches get flushed,
+ * or an object's class changes). Call-site caches filled
+ * in an older generation are invalid.
+ */
+unsigned int objc_dispatch_generation;
+
 /**
  * A cached forwarding selectors.
  */
@@ -144,27 +184,342 @@ OBJC_INLINE void _initialize_method_list(objc_array *method_list){
  */
 OBJC_INLINE Method _lookup_method_in_method_list(objc_array method_list, SEL selector) OBJC_ALWAYS_INLINE;
 OBJC_INLINE Method _lookup_method_in_method_list(objc_array method_list, SEL selector){
-	objc_array_enumerator en;
+	Method **lists;
+	unsigned int count;
+	unsigned int i;
 	
 	if (method_list == NULL){
 		return NULL;
 	}
 	
-	en = objc_array_get_enumerator(method_list);
-	while (en != NULL) {
-		Method *methods = en->item;
+	lists = (Method**)objc_array_get_items(method_list, &count);
+	for (i = 0; i < count; ++i){
+		Method *methods = lists[i];
 		while (*methods != NULL){
 			if (objc_selectors_equal(selector, (*methods)->selector)){
 				return *methods;
 			}
 			++methods;
 		}
-		en = en->next;
 	}
 		
 	return NULL;
 }
 
+/**
+ * Method table - the methods of a class sorted by the selector address,
+ * as there's a single SEL per name. The table is a structure of arrays:
+ * the selectors are kept apart from the methods so that a search only
+ * touches the selectors, which are then compared several at a time
+ * (see _method_table_scan). The implementation stays in the method,
+ * as it may be replaced while the table is in use. If several
+ * methods have the same selector, only the first added one is kept,
+ * just as the method list lookup would find it first.
+ *
+ * count - number of methods.
+ * selectors - sorted selectors.
+ * methods - methods in the order of selectors.
+ *
+ * The structure is followed by both arrays. A table is never modified
+ * once published - adding methods publishes a new table and retires
+ * the old one (see reclaim.h).
+ */
+struct objc_method_table {
+	unsigned int count;
+	SEL *selectors;
+	Method *methods;
+};
+
+/**
+ * Tables up to this size are scanned linearly, as a scan
+ * of a few selectors is cheaper than a binary search. Larger
+ * tables are binary-searched down to a range of this size,
+ * which is then scanned.
+ */
+#define OBJC_METHOD_TABLE_LINEAR_SCAN_LIMIT 8
+
+/**
+ * Allocates a method table for count methods.
+ */
+OBJC_INLINE struct objc_method_table *_method_table_create(unsigned int count) OBJC_ALWAYS_INLINE;
+OBJC_INLINE struct objc_method_table *_method_table_create(unsigned int count){
+	struct objc_method_table *table = objc_alloc(sizeof(struct objc_method_table) + count * (sizeof(SEL) + sizeof(Method)));
+	table->count = count;
+	table->selectors = (SEL*)(table + 1);
+	table->methods = (Method*)(table->selectors + count);
+	return table;
+}
+
+/**
+ * Returns the index of selector among count selectors, or count if
+ * it's not there. With AVX2, four 64-bit selectors are compared by
+ * a single instruction (eight 32-bit ones), with SSE2 two (four).
+ * SSE2 has no 64-bit comparison, hence 32-bit halves are compared
+ * and a selector matches if both of its halves do.
+ */
+OBJC_INLINE unsigned int _method_table_scan(SEL *selectors, unsigned int count, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE unsigned int _method_table_scan(SEL *selectors, unsigned int count, SEL selector){
+	unsigned int index = 0;
+	
+#if OBJC_USES_SIMD_SELECTOR_SCAN && defined(__AVX2__)
+	#define OBJC_SELECTORS_PER_VECTOR (sizeof(__m256i) / sizeof(SEL))
+	__m256i key = (sizeof(SEL) == 8) ? _mm256_set1_epi64x((long long)(long)selector) : _mm256_set1_epi32((int)(long)selector);
+	for ( ; index + OBJC_SELECTORS_PER_VECTOR <= count; index += OBJC_SELECTORS_PER_VECTOR){
+		__m256i vector = _mm256_loadu_si256((const __m256i*)(selectors + index));
+		__m256i equal = (sizeof(SEL) == 8) ? _mm256_cmpeq_epi64(vector, key) : _mm256_cmpeq_epi32(vector, key);
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(equal);
+		if (mask != 0){
+			return index + __builtin_ctz(mask) / sizeof(SEL);
+		}
+	}
+	#undef OBJC_SELECTORS_PER_VECTOR
+#elif OBJC_USES_SIMD_SELECTOR_SCAN && defined(__SSE2__)
+	#define OBJC_SELECTORS_PER_VECTOR (sizeof(__m128i) / sizeof(SEL))
+	__m128i key = (sizeof(SEL) == 8) ? _mm_set1_epi64x((long long)(long)selector) : _mm_set1_epi32((int)(long)selector);
+	for ( ; index + OBJC_SELECTORS_PER_VECTOR <= count; index += OBJC_SELECTORS_PER_VECTOR){
+		__m128i vector = _mm_loadu_si128((const __m128i*)(selectors + index));
+		__m128i equal = _mm_cmpeq_epi32(vector, key);
+		unsigned int mask;
+		if (sizeof(SEL) == 8){
+			/* Both halves must match - swap them and AND. */
+			equal = _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+		}
+		mask = (unsigned int)_mm_movemask_epi8(equal);
+		if (mask != 0){
+			return index + __builtin_ctz(mask) / sizeof(SEL);
+		}
+	}
+	#undef OBJC_SELECTORS_PER_VECTOR
+#endif
+	
+	for ( ; index < count; ++index){
+		if (selectors[index] == selector){
+			return index;
+		}
+	}
+	return count;
+}
+
+/**
+ * Returns the method for selector in table, or NULL.
+ */
+OBJC_INLINE Method _method_table_lookup(struct objc_method_table *table, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE Method _method_table_lookup(struct objc_method_table *table, SEL selector){
+	SEL *selectors = table->selectors;
+	unsigned int count = table->count;
+	unsigned int index = 0;
+	unsigned int found;
+	
+	/*
+	 * Branch-free binary search - the loop only depends on count,
+	 * the comparison merely selects the half, which compiles
+	 * into a conditional move. The selector, if present, is always
+	 * within count selectors starting at index.
+	 */
+	while (count > OBJC_METHOD_TABLE_LINEAR_SCAN_LIMIT){
+		unsigned int half = count / 2;
+		index = ((unsigned long)selectors[index + half] <= (unsigned long)selector) ? index + half : index;
+		count -= half;
+	}
+	
+	found = _method_table_scan(selectors + index, count, selector);
+	return found < count ? table->methods[index + found] : NULL;
+}
+
+/**
+ * Sorts count pointers by the key returned for each of them, using buffer
+ * of the same size. Bottom-up merge sort, which is stable. Returns either
+ * items or buffer, whichever ends up holding the sorted pointers.
+ */
+OBJC_INLINE void **_sort_pointers_by_key(void **items, void **buffer, unsigned int count, unsigned long (*key)(void *item)) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void **_sort_pointers_by_key(void **items, void **buffer, unsigned int count, unsigned long (*key)(void *item)){
+	void **source = items;
+	void **destination = buffer;
+	unsigned int width;
+	
+	for (width = 1; width < count; width *= 2){
+		unsigned int start;
+		void **swap;
+		
+		for (start = 0; start < count; start += 2 * width){
+			unsigned int left = start;
+			unsigned int middle = start + width < count ? start + width : count;
+			unsigned int end = start + 2 * width < count ? start + 2 * width : count;
+			unsigned int right = middle;
+			unsigned int index;
+			
+			for (index = start; index < end; ++index){
+				if (left < middle && (right >= end || key(source[left]) <= key(source[right]))){
+					destination[index] = source[left++];
+				}else{
+					destination[index] = source[right++];
+				}
+			}
+		}
+		
+		swap = source;
+		source = destination;
+		destination = swap;
+	}
+	return source;
+}
+
+OBJC_INLINE unsigned long _method_selector_key(void *method) OBJC_ALWAYS_INLINE;
+OBJC_INLINE unsigned long _method_selector_key(void *method){
+	return (unsigned long)((Method)method)->selector;
+}
+
+/**
+ * Sorts methods by selector. The sort is stable, so that the first
+ * added of methods with the same selector stays first. Merge sort,
+ * as a class may have hundreds of methods.
+ */
+OBJC_INLINE void _sort_methods_by_selector(Method *methods, unsigned int count) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _sort_methods_by_selector(Method *methods, unsigned int count){
+	Method *buffer;
+	Method *sorted;
+	
+	if (count < 2){
+		return;
+	}
+	
+	buffer = objc_alloc(count * sizeof(Method));
+	sorted = (Method *)_sort_pointers_by_key((void **)methods, (void **)buffer, count, _method_selector_key);
+	if (sorted != methods){
+		unsigned int index;
+		for (index = 0; index < count; ++index){
+			methods[index] = sorted[index];
+		}
+	}
+	objc_dealloc(buffer);
+}
+
+/**
+ * Returns a new table containing the methods of table (may be NULL)
+ * and count methods m, which are sorted in place. The methods of table
+ * take precedence over m, as they have been added before.
+ */
+OBJC_INLINE struct objc_method_table *_method_table_create_merged(struct objc_method_table *table, Method *m, unsigned int count) OBJC_ALWAYS_INLINE;
+OBJC_INLINE struct objc_method_table *_method_table_create_merged(struct objc_method_table *table, Method *m, unsigned int count){
+	unsigned int old_count = table == NULL ? 0 : table->count;
+	struct objc_method_table *new_table = _method_table_create(old_count + count);
+	unsigned int old_index = 0;
+	unsigned int index = 0;
+	unsigned int new_count = 0;
+	
+	_sort_methods_by_selector(m, count);
+	
+	while (old_index < old_count || index < count){
+		Method method;
+		if (index >= count || (old_index < old_count && (unsigned long)table->selectors[old_index] <= (unsigned long)m[index]->selector)){
+			method = table->methods[old_index++];
+		}else{
+			method = m[index++];
+		}
+		
+		/* Already there - the first one wins. */
+		if (new_count > 0 && new_table->selectors[new_count - 1] == method->selector){
+			continue;
+		}
+		
+		new_table->selectors[new_count] = method->selector;
+		new_table->methods[new_count] = method;
+		++new_count;
+	}
+	new_table->count = new_count;
+	
+	return new_table;
+}
+
+/**
+ * Publishes a table built out of the table at table_ptr and methods m.
+ * Must be called with objc_runtime_lock held.
+ */
+OBJC_INLINE void _method_table_add_methods_locked(struct objc_method_table **table_ptr, Method *m, unsigned int count) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _method_table_add_methods_locked(struct objc_method_table **table_ptr, Method *m, unsigned int count){
+	struct objc_method_table *old_table = *table_ptr;
+	Method *methods = objc_alloc((count + 1) * sizeof(Method));
+	unsigned int i;
+	
+	/* Sorted in place - the caller's order must be kept. */
+	for (i = 0; i < count; ++i){
+		methods[i] = m[i];
+	}
+	
+	objc_atomic_store_release(table_ptr, _method_table_create_merged(old_table, methods, count));
+	if (old_table != NULL){
+		objc_reclaim_retire(old_table);
+	}
+	objc_dealloc(methods);
+}
+
+/**
+ * Builds the table at table_ptr from the method list.
+ * Must be called with objc_runtime_lock held.
+ */
+OBJC_INLINE void _method_table_build_locked(struct objc_method_table **table_ptr, objc_array method_list) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _method_table_build_locked(struct objc_method_table **table_ptr, objc_array method_list){
+	Method *methods = objc_method_list_flatten(method_list);
+	unsigned int count = 0;
+	
+	while (methods[count] != NULL){
+		++count;
+	}
+	
+	_method_table_add_methods_locked(table_ptr, methods, count);
+	objc_dealloc(methods);
+}
+
+/**
+ * Builds the method tables of a class.
+ * Must be called with objc_runtime_lock held.
+ */
+OBJC_INLINE void _build_method_tables_locked(Class cl) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _build_method_tables_locked(Class cl){
+	_method_table_build_locked(&cl->class_method_table, cl->class_methods);
+	_method_table_build_locked(&cl->instance_method_table, cl->instance_methods);
+}
+
+/**
+ * Looks up a method in the table at table_ptr, or, if the table hasn't
+ * been built yet, in the method list.
+ */
+OBJC_INLINE Method _lookup_method_in_class_methods(struct objc_method_table **table_ptr, objc_array method_list, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE Method _lookup_method_in_class_methods(struct objc_method_table **table_ptr, objc_array method_list, SEL selector){
+	struct objc_method_table *table;
+	Method m;
+	
+	objc_reclaim_enter();
+	table = objc_atomic_load_acquire(table_ptr);
+	if (table != NULL){
+		m = _method_table_lookup(table, selector);
+	}else{
+		m = _lookup_method_in_method_list(method_list, selector);
+	}
+	objc_reclaim_exit();
+	
+	return m;
+}
+
+/**
+ * Looks up a method in the dispatch table at table_ptr. Returns NO
+ * if there is no dispatch table (e.g. it's being rebuilt), in which
+ * case the class hierarchy needs to be searched.
+ */
+OBJC_INLINE BOOL _lookup_method_in_dispatch_table(struct objc_method_table **table_ptr, SEL selector, Method *m) OBJC_ALWAYS_INLINE;
+OBJC_INLINE BOOL _lookup_method_in_dispatch_table(struct objc_method_table **table_ptr, SEL selector, Method *m){
+	struct objc_method_table *table;
+	
+	objc_reclaim_enter();
+	table = objc_atomic_load_acquire(table_ptr);
+	if (table != NULL){
+		*m = _method_table_lookup(table, selector);
+	}
+	objc_reclaim_exit();
+	
+	return table != NULL;
+}
+
 /**
  * Searches for an instance method among class extensions.
  */
@@ -212,10 +567,13 @@ OBJC_INLINE Method _lookup_extension_class_method(Class cl, SEL selector){
 }
 
 /**
- * Looks up a method for a selector in a cache.
+ * Looks up a method for a selector in a cache. The cache may get flushed
+ * by another thread meanwhile, hence it's loaded just once and must be
+ * read within a reclamation section (see reclaim.h).
  */
-OBJC_INLINE Method _lookup_cached_method(objc_cache cache, SEL selector) OBJC_ALWAYS_INLINE;
-OBJC_INLINE Method _lookup_cached_method(objc_cache cache, SEL selector){
+OBJC_INLINE Method _lookup_cached_method(objc_cache *cache_ptr, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE Method _lookup_cached_method(objc_cache *cache_ptr, SEL selector){
+	objc_cache cache = objc_atomic_load_acquire(cache_ptr);
 	if (cache == NULL){
 		return NULL;
 	}
@@ -223,14 +581,100 @@ OBJC_INLINE Method _lookup_cached_method(objc_cache cache, SEL selector){
 }
 
 /**
- * Adds a method to a cache. If *cache == NULL, it gets created.
+ * Looks up a method implementation for a selector in a cache.
+ * Unlike _lookup_cached_method, this doesn't need to touch
+ * the Method structure at all.
+ */
+OBJC_INLINE IMP _lookup_cached_imp(objc_cache *cache_ptr, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE IMP _lookup_cached_imp(objc_cache *cache_ptr, SEL selector){
+	objc_cache cache = objc_atomic_load_acquire(cache_ptr);
+	if (cache == NULL){
+		return NULL;
+	}
+	return objc_cache_fetch_imp(cache, selector);
+}
+
+/**
+ * Tells the cache being derived which selectors the class
+ * implements itself, hence which entries of the superclass'
+ * cache it mustn't take over.
+ */
+typedef struct {
+	Class cl;
+	BOOL class_methods;
+} _cache_derivation_context;
+
+static BOOL _class_overrides_selector(void *context, SEL selector){
+	_cache_derivation_context *derivation = (_cache_derivation_context*)context;
+	Class cl = derivation->cl;
+	
+	if (derivation->class_methods){
+		return _lookup_extension_class_method(cl, selector) != NULL
+			|| _lookup_method_in_class_methods(&cl->class_method_table, cl->class_methods, selector) != NULL;
+	}
+	return _lookup_extension_instance_method(cl, selector) != NULL
+		|| _lookup_method_in_class_methods(&cl->instance_method_table, cl->instance_methods, selector) != NULL;
+}
+
+/**
+ * Creates a cache of cl. If the superclass has a cache, the new one is
+ * derived from it, so that the cache may share the entries the class
+ * doesn't override with the superclass. With cl == Nil, the cache
+ * is created empty, which is what the forwarding caches need.
  */
-OBJC_INLINE void _cache_method(objc_cache *cache, Method m) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void _cache_method(objc_cache *cache, Method m){
-	if (*cache == NULL){
-		*cache = objc_cache_create();
+OBJC_INLINE objc_cache _cache_create(Class cl, BOOL class_methods) OBJC_ALWAYS_INLINE;
+OBJC_INLINE objc_cache _cache_create(Class cl, BOOL class_methods){
+	_cache_derivation_context derivation;
+	objc_cache superclass_cache;
+	objc_cache c;
+	
+	if (cl == Nil || cl->super_class == Nil){
+		return objc_cache_create();
+	}
+	
+	derivation.cl = cl;
+	derivation.class_methods = class_methods;
+	
+	objc_reclaim_enter();
+	superclass_cache = objc_atomic_load_acquire(class_methods ? &cl->super_class->class_cache : &cl->super_class->instance_cache);
+	if (superclass_cache == NULL){
+		c = objc_cache_create();
+	}else{
+		c = objc_cache_derive(superclass_cache, _class_overrides_selector, &derivation);
 	}
-	objc_cache_insert(*cache, m);
+	objc_reclaim_exit();
+	
+	return c;
+}
+
+/**
+ * Adds a method to a cache under selector. If *cache == NULL, it gets created
+ * (see _cache_create). Two threads may be creating the cache at once - only
+ * one of them publishes it, the other one destroys its own.
+ */
+OBJC_INLINE void _cache_method_for_selector(objc_cache *cache, Class cl, BOOL class_methods, SEL selector, Method m) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _cache_method_for_selector(objc_cache *cache, Class cl, BOOL class_methods, SEL selector, Method m){
+	objc_cache c = objc_atomic_load_acquire(cache);
+	if (c == NULL){
+		c = _cache_create(cl, class_methods);
+		if (!objc_atomic_compare_and_swap(cache, NULL, c)){
+			objc_cache_destroy(c);
+			c = objc_atomic_load_acquire(cache);
+			if (c == NULL){
+				/* Flushed right away, no need to cache anything. */
+				return;
+			}
+		}
+	}
+	objc_cache_insert(c, selector, m);
+}
+
+/**
+ * Adds a method to the class or instance cache of cl.
+ */
+OBJC_INLINE void _cache_method(Class cl, BOOL class_methods, Method m) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _cache_method(Class cl, BOOL class_methods, Method m){
+	_cache_method_for_selector(class_methods ? &cl->class_cache : &cl->instance_cache, cl, class_methods, m->selector, m);
 }
 
 /**
@@ -244,6 +688,10 @@ OBJC_INLINE Method _lookup_class_method(Class cl, SEL selector){
 		return NULL;
 	}
 	
+	if (cl->flags.eager_dispatch && _lookup_method_in_dispatch_table(&cl->class_dispatch_table, selector, &m)){
+		return m;
+	}
+	
 	while (cl != NULL){
 		m = _lookup_extension_class_method(cl, selector);
 		if (m != NULL){
@@ -251,7 +699,7 @@ OBJC_INLINE Method _lookup_class_method(Class cl, SEL selector){
 			return m;
 		}
 		
-		m = _lookup_method_in_method_list(cl->class_methods, selector);
+		m = _lookup_method_in_class_methods(&cl->class_method_table, cl->class_methods, selector);
 		if (m != NULL){
 			return m;
 		}
@@ -267,9 +715,10 @@ OBJC_INLINE Method _lookup_class_method(Class cl, SEL selector){
  */
 OBJC_INLINE IMP _lookup_class_method_impl(Class cl, SEL selector) OBJC_ALWAYS_INLINE;
 OBJC_INLINE IMP _lookup_class_method_impl(Class cl, SEL selector){
-	Method m = _lookup_cached_method(cl->class_cache, selector);
-	if (m != NULL){
-		return m->implementation;
+	Method m;
+	IMP imp = _lookup_cached_imp(&cl->class_cache, selector);
+	if (imp != NULL){
+		return imp;
 	}
 	
 	m = _lookup_class_method(cl, selector);
@@ -277,7 +726,7 @@ OBJC_INLINE IMP _lookup_class_method_impl(Class cl, SEL selector){
 		return NULL;
 	}
 	
-	_cache_method(&cl->class_cache, m);
+	_cache_method(cl, YES, m);
 	return m->implementation;
 }
 
@@ -292,6 +741,10 @@ OBJC_INLINE Method _lookup_instance_method(Class class, SEL selector){
 		return NULL;
 	}
 	
+	if (class->flags.eager_dispatch && _lookup_method_in_dispatch_table(&class->instance_dispatch_table, selector, &m)){
+		return m;
+	}
+	
 	while (class != NULL){
 		m = _lookup_extension_instance_method(class, selector);
 		if (m != NULL){
@@ -299,7 +752,7 @@ OBJC_INLINE Method _lookup_instance_method(Class class, SEL selector){
 			return m;
 		}
 		
-		m = _lookup_method_in_method_list(class->instance_methods, selector);
+		m = _lookup_method_in_class_methods(&class->instance_method_table, class->instance_methods, selector);
 		if (m != NULL){
 			return m;
 		}
@@ -315,9 +768,10 @@ OBJC_INLINE Method _lookup_instance_method(Class class, SEL selector){
  */
 OBJC_INLINE IMP _lookup_instance_method_impl(Class cl, SEL selector) OBJC_ALWAYS_INLINE;
 OBJC_INLINE IMP _lookup_instance_method_impl(Class cl, SEL selector){
-	Method m = _lookup_cached_method(cl->instance_cache, selector);
-	if (m != NULL){
-		return m->implementation;
+	Method m;
+	IMP imp = _lookup_cached_imp(&cl->instance_cache, selector);
+	if (imp != NULL){
+		return imp;
 	}
 	
 	m = _lookup_instance_method(cl, selector);
@@ -325,22 +779,99 @@ OBJC_INLINE IMP _lookup_instance_method_impl(Class cl, SEL selector){
 		return NULL;
 	}
 	
-	_cache_method(&cl->instance_cache, m);
+	_cache_method(cl, NO, m);
 	return m->implementation;
 }
 
 /**
- * Returns whether cl is a subclass of superclass_candidate.
+ * Looks up a class method in the class cache and if it isn't
+ * there, searches for it and caches it.
  */
-OBJC_INLINE BOOL _class_is_subclass_of_class(Class cl, Class superclass_candidate) OBJC_ALWAYS_INLINE;
-OBJC_INLINE BOOL _class_is_subclass_of_class(Class cl, Class superclass_candidate){
-	while (cl != Nil) {
-		if (cl->super_class == superclass_candidate){
-			return YES;
+OBJC_INLINE Method _lookup_class_method_and_cache(Class cl, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE Method _lookup_class_method_and_cache(Class cl, SEL selector){
+	Method method = _lookup_cached_method(&cl->class_cache, selector);
+	if (method != NULL){
+		return method;
+	}
+	
+	method = _lookup_class_method(cl, selector);
+	if (method != NULL){
+		_cache_method(cl, YES, method);
+	}
+	return method;
+}
+
+/**
+ * Looks up an instance method in the instance cache and if it isn't
+ * there, searches for it and caches it.
+ */
+OBJC_INLINE Method _lookup_instance_method_and_cache(Class cl, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE Method _lookup_instance_method_and_cache(Class cl, SEL selector){
+	Method method = _lookup_cached_method(&cl->instance_cache, selector);
+	if (method != NULL){
+		return method;
+	}
+	
+	method = _lookup_instance_method(cl, selector);
+	if (method != NULL){
+		_cache_method(cl, NO, method);
+	}
+	return method;
+}
+
+/**
+ * Links cl into the subclass tree of its superclass. Must be called
+ * with the run-time lock held, which serializes the writers. The class
+ * is published last, so that concurrent walks of the tree see it complete.
+ */
+OBJC_INLINE void _link_class_to_superclass(Class cl) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _link_class_to_superclass(Class cl){
+	cl->first_subclass = Nil;
+	cl->next_sibling = Nil;
+	if (cl->super_class == Nil){
+		return;
+	}
+	
+	cl->next_sibling = cl->super_class->first_subclass;
+	objc_atomic_store_release(&cl->super_class->first_subclass, cl);
+}
+
+/**
+ * Fills the depth and display of cl, whose superclass has already
+ * been set. The superclass is finished, hence has its display.
+ */
+OBJC_INLINE void _build_class_display(Class cl) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _build_class_display(Class cl){
+	unsigned int i;
+	
+	cl->depth = cl->super_class == Nil ? 0 : cl->super_class->depth + 1;
+	cl->display = objc_alloc((cl->depth + 1) * sizeof(Class));
+	for (i = 0; i < cl->depth; ++i){
+		cl->display[i] = cl->super_class->display[i];
+	}
+	cl->display[cl->depth] = cl;
+}
+
+/**
+ * Returns the class following cl in a pre-order walk of the subtree
+ * of root, or Nil if the whole subtree has been visited. The walk
+ * starts with root->first_subclass.
+ */
+OBJC_INLINE Class _next_class_in_subtree(Class cl, Class root) OBJC_ALWAYS_INLINE;
+OBJC_INLINE Class _next_class_in_subtree(Class cl, Class root){
+	Class next = objc_atomic_load_acquire(&cl->first_subclass);
+	if (next != Nil){
+		return next;
+	}
+	
+	while (cl != root){
+		next = objc_atomic_load_acquire(&cl->next_sibling);
+		if (next != Nil){
+			return next;
 		}
 		cl = cl->super_class;
 	}
-	return NO;
+	return Nil;
 }
 
 /**
@@ -348,18 +879,202 @@ OBJC_INLINE BOOL _class_is_subclass_of_class(Class cl, Class superclass_candidat
  */
 OBJC_INLINE void _flush_cache(objc_cache *cache) OBJC_ALWAYS_INLINE;
 OBJC_INLINE void _flush_cache(objc_cache *cache){
+	objc_cache old_cache;
+	
 	if (cache == NULL){
 		/* This is wrong. *cache may be NULL, cache no. */
 		objc_abort("Cache == NULL in _flush_cache!");
 	}
 	
-	if (*cache != NULL){
-		objc_cache old_cache = *cache;
-		*cache = NULL;
+	/* The old cache is retired, lookups running meanwhile may still read it. */
+	old_cache = objc_atomic_exchange(cache, NULL);
+	if (old_cache != NULL){
 		objc_cache_destroy(old_cache);
 	}
 }
 
+/**
+ * Moves on to the next dispatch generation. Must be called
+ * *after* the mutation is complete - a lookup started in the new
+ * generation must already see the result of the mutation.
+ */
+OBJC_INLINE void _invalidate_dispatch_generation(void) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _invalidate_dispatch_generation(void){
+	objc_atomic_increment(&objc_dispatch_generation);
+}
+
+/**
+ * Returns YES if each extension with a lookup function can list
+ * the methods it looks up, i.e. a dispatch table can be complete.
+ */
+OBJC_INLINE BOOL _extensions_can_list_methods(BOOL class_methods) OBJC_ALWAYS_INLINE;
+OBJC_INLINE BOOL _extensions_can_list_methods(BOOL class_methods){
+	objc_class_extension *ext;
+	for (ext = class_extensions; ext != NULL; ext = ext->next_extension){
+		if (class_methods && ext->class_lookup_function != NULL && ext->class_methods_function == NULL){
+			return NO;
+		}
+		if (!class_methods && ext->instance_lookup_function != NULL && ext->instance_methods_function == NULL){
+			return NO;
+		}
+	}
+	return YES;
+}
+
+/**
+ * Replaces *table with a table that also contains the methods
+ * of other. Methods of *table take precedence. Neither is published.
+ */
+OBJC_INLINE void _method_table_merge(struct objc_method_table **table, struct objc_method_table *other) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _method_table_merge(struct objc_method_table **table, struct objc_method_table *other){
+	struct objc_method_table *merged;
+	Method *methods = objc_alloc((other->count + 1) * sizeof(Method));
+	unsigned int i;
+	
+	for (i = 0; i < other->count; ++i){
+		methods[i] = other->methods[i];
+	}
+	
+	merged = _method_table_create_merged(*table, methods, other->count);
+	objc_dealloc(methods);
+	if (*table != NULL){
+		objc_dealloc(*table);
+	}
+	*table = merged;
+}
+
+/**
+ * Creates a dispatch table of cl - the methods of the extensions, then
+ * the methods of the class and then its superclass' dispatch table,
+ * which is the order in which _lookup_instance_method searches them.
+ * If the superclass doesn't have a dispatch table, a temporary one
+ * is created. Must be called with objc_runtime_lock held.
+ */
+static struct objc_method_table *_dispatch_table_create(Class cl, BOOL class_methods){
+	struct objc_method_table *table = NULL;
+	struct objc_method_table *own_table = class_methods ? cl->class_method_table : cl->instance_method_table;
+	objc_class_extension *ext;
+	
+	for (ext = class_extensions; ext != NULL; ext = ext->next_extension){
+		Method *(*methods_function)(Class) = class_methods ? ext->class_methods_function : ext->instance_methods_function;
+		Method *methods;
+		struct objc_method_table *merged;
+		unsigned int count = 0;
+		
+		if (methods_function == NULL){
+			continue;
+		}
+		
+		methods = methods_function(cl);
+		while (methods[count] != NULL){
+			++count;
+		}
+		
+		merged = _method_table_create_merged(table, methods, count);
+		objc_dealloc(methods);
+		if (table != NULL){
+			objc_dealloc(table);
+		}
+		table = merged;
+	}
+	
+	if (own_table != NULL){
+		_method_table_merge(&table, own_table);
+	}
+	
+	if (cl->super_class != Nil){
+		Class superclass = cl->super_class;
+		struct objc_method_table *super_table = class_methods ? superclass->class_dispatch_table : superclass->instance_dispatch_table;
+		if (super_table != NULL){
+			_method_table_merge(&table, super_table);
+		}else{
+			super_table = _dispatch_table_create(superclass, class_methods);
+			_method_table_merge(&table, super_table);
+			objc_dealloc(super_table);
+		}
+	}
+	
+	if (table == NULL){
+		table = _method_table_create(0);
+	}
+	return table;
+}
+
+/**
+ * (Re)builds a dispatch table of cl and fills the cache with it,
+ * unless cl doesn't use eager dispatch. When rebuilding, the caches
+ * are flushed first, as they may contain methods that have been
+ * overridden since. Must be called with objc_runtime_lock held.
+ */
+OBJC_INLINE void _build_dispatch_table_locked(Class cl, BOOL class_methods, BOOL flush_caches) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _build_dispatch_table_locked(Class cl, BOOL class_methods, BOOL flush_caches){
+	struct objc_method_table **table_ptr = class_methods ? &cl->class_dispatch_table : &cl->instance_dispatch_table;
+	objc_cache *cache = class_methods ? &cl->class_cache : &cl->instance_cache;
+	struct objc_method_table *table;
+	struct objc_method_table *old_table;
+	unsigned int i;
+	
+	if (!cl->flags.eager_dispatch || !_extensions_can_list_methods(class_methods)){
+		return;
+	}
+	
+	table = _dispatch_table_create(cl, class_methods);
+	old_table = objc_atomic_exchange(table_ptr, table);
+	if (old_table != NULL){
+		objc_reclaim_retire(old_table);
+	}
+	
+	if (flush_caches){
+		_flush_cache(cache);
+		_flush_cache(class_methods ? &cl->class_forwarding_cache : &cl->instance_forwarding_cache);
+	}
+	
+	for (i = 0; i < table->count; ++i){
+		_cache_method_for_selector(cache, cl, class_methods, table->selectors[i], table->methods[i]);
+	}
+}
+
+/**
+ * Removes the dispatch tables of cl and its subclasses, so that
+ * lookups search the class hierarchy until they get rebuilt.
+ */
+OBJC_INLINE void _drop_dispatch_tables_in_subtree(Class cl, BOOL class_methods) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _drop_dispatch_tables_in_subtree(Class cl, BOOL class_methods){
+	Class subclass;
+	
+	if (!objc_eager_dispatch_in_use){
+		return;
+	}
+	
+	for (subclass = cl; subclass != Nil; subclass = _next_class_in_subtree(subclass, cl)){
+		struct objc_method_table *table = objc_atomic_exchange(class_methods ? &subclass->class_dispatch_table : &subclass->instance_dispatch_table, NULL);
+		if (table != NULL){
+			objc_reclaim_retire(table);
+		}
+	}
+}
+
+/**
+ * Rebuilds the dispatch tables of cl and its subclasses. The walk
+ * is pre-order, so superclasses get rebuilt before their subclasses.
+ */
+OBJC_INLINE void _rebuild_dispatch_tables_in_subtree(Class cl, BOOL class_methods) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _rebuild_dispatch_tables_in_subtree(Class cl, BOOL class_methods){
+	Class subclass;
+	
+	if (!objc_eager_dispatch_in_use){
+		return;
+	}
+	
+	objc_rw_lock_wlock(objc_runtime_lock);
+	for (subclass = cl; subclass != Nil; subclass = _next_class_in_subtree(subclass, cl)){
+		if (!subclass->flags.in_construction){
+			_build_dispatch_table_locked(subclass, class_methods, YES);
+		}
+	}
+	objc_rw_lock_unlock(objc_runtime_lock);
+}
+
 /**
  * Adds methods from the array 'm' into the method_list. The m array doesn't
  * have to be NULL-terminated, and has to contain 'count' methods.
@@ -392,20 +1107,26 @@ OBJC_INLINE void _add_methods_to_method_list(objc_array method_list, Method *m,
 }
 
 /**
- * Goes through the class list and flushes cache of each subclass of cl.
+ * Walks the subclass tree of cl and flushes cache of each subclass.
  *
  * class_methods indicates, whether to flush class-method cache, or instance-method cache.
  */
 OBJC_INLINE void _flush_caches_of_subclasses_of_class(Class cl, BOOL class_methods) OBJC_ALWAYS_INLINE;
 OBJC_INLINE void _flush_caches_of_subclasses_of_class(Class cl, BOOL class_methods){
-	objc_array_enumerator en = objc_array_get_enumerator(objc_classes_array);
-	while (en != NULL){
-		Class subclass = en->item;
-		if (_class_is_subclass_of_class(subclass, cl)){
-			/* The class is subclass of this class -> flush. */
-			_flush_cache(class_methods ? subclass->class_cache : subclass->instance_cache);
+	Class subclass = objc_atomic_load_acquire(&cl->first_subclass);
+	
+	/* Rebuilt when flushing the cache of cl below. */
+	_drop_dispatch_tables_in_subtree(cl, class_methods);
+	
+	while (subclass != Nil){
+		if (class_methods){
+			_flush_cache(&subclass->class_cache);
+			_flush_cache(&subclass->class_forwarding_cache);
+		}else{
+			_flush_cache(&subclass->instance_cache);
+			_flush_cache(&subclass->instance_forwarding_cache);
 		}
-		en = en->next;
+		subclass = _next_class_in_subtree(subclass, cl);
 	}
 	
 	/* Flush cache of the class as well. */
@@ -439,6 +1160,30 @@ OBJC_INLINE BOOL _any_method_implemented_by_superclasses(Method *m, unsigned int
 	return NO;
 }
 
+/**
+ * Goes through the methods and checks if any of their selectors
+ * has been forwarded (or dropped) by cl or any of its subclasses.
+ * Such an outcome is cached and would shadow the new method.
+ */
+OBJC_INLINE BOOL _any_method_forwarded_by_class_or_subclasses(Method *m, unsigned int count, Class cl, BOOL class_methods) OBJC_ALWAYS_INLINE;
+OBJC_INLINE BOOL _any_method_forwarded_by_class_or_subclasses(Method *m, unsigned int count, Class cl, BOOL class_methods){
+	BOOL forwarded = NO;
+	Class subclass = cl;
+	
+	objc_reclaim_enter();
+	while (subclass != Nil && !forwarded){
+		objc_cache *cache = class_methods ? &subclass->class_forwarding_cache : &subclass->instance_forwarding_cache;
+		unsigned int i;
+		for (i = 0; i < count && !forwarded; ++i){
+			forwarded = (BOOL)(_lookup_cached_method(cache, m[i]->selector) != NULL);
+		}
+		subclass = _next_class_in_subtree(subclass, cl);
+	}
+	objc_reclaim_exit();
+	
+	return forwarded;
+}
+
 /**
  * Adds class methods to class cl.
  */
@@ -451,21 +1196,35 @@ OBJC_INLINE void _add_class_methods(Class cl, Method *m, unsigned int count){
 	_initialize_method_list(&cl->class_methods);
 	_add_methods_to_method_list(cl->class_methods, m, count);
 	
+	/* A finished class needs to have the new methods merged into its table. */
+	if (objc_atomic_load_acquire(&cl->class_method_table) != NULL){
+		objc_rw_lock_wlock(objc_runtime_lock);
+		_method_table_add_methods_locked(&cl->class_method_table, m, count);
+		objc_rw_lock_unlock(objc_runtime_lock);
+	}
+	
 	/**
 	 * Unfortunately, as the cl's superclass might
 	 * have implemented this method, which might
 	 * have been cached by its subclasses.
 	 *
 	 * First, we figure out, it it really is this scenario.
+	 * The same goes for a selector that has been forwarded.
 	 *
 	 * If it is, we need to find all subclasses and flush
 	 * their caches.
 	 */
 	
-	if (_any_method_implemented_by_superclasses(m, count, cl, YES)){
+	if (_any_method_implemented_by_superclasses(m, count, cl, YES)
+	    || _any_method_forwarded_by_class_or_subclasses(m, count, cl, YES)){
 		/* Need to indeed flush caches. */
 		_flush_caches_of_subclasses_of_class(cl, YES);
+	}else{
+		/* Dispatch tables list all the methods, the new ones need to get there. */
+		_rebuild_dispatch_tables_in_subtree(cl, YES);
 	}
+	
+	_invalidate_dispatch_generation();
 }
 
 /**
@@ -480,21 +1239,35 @@ OBJC_INLINE void _add_instance_methods(Class cl, Method *m, unsigned int count){
 	_initialize_method_list(&cl->instance_methods);
 	_add_methods_to_method_list(cl->instance_methods, m, count);
 	
+	/* A finished class needs to have the new methods merged into its table. */
+	if (objc_atomic_load_acquire(&cl->instance_method_table) != NULL){
+		objc_rw_lock_wlock(objc_runtime_lock);
+		_method_table_add_methods_locked(&cl->instance_method_table, m, count);
+		objc_rw_lock_unlock(objc_runtime_lock);
+	}
+	
 	/**
 	 * Unfortunately, as the cl's superclass might
 	 * have implemented this method, which might
 	 * have been cached by its subclasses.
 	 *
 	 * First, we figure out, it it really is this scenario.
+	 * The same goes for a selector that has been forwarded.
 	 *
 	 * If it is, we need to find all subclasses and flush
 	 * their caches.
 	 */
 	
-	if (_any_method_implemented_by_superclasses(m, count, cl, NO)){
+	if (_any_method_implemented_by_superclasses(m, count, cl, NO)
+	    || _any_method_forwarded_by_class_or_subclasses(m, count, cl, NO)){
 		/* Need to indeed flush caches. */
 		_flush_caches_of_subclasses_of_class(cl, NO);
+	}else{
+		/* Dispatch tables list all the methods, the new ones need to get there. */
+		_rebuild_dispatch_tables_in_subtree(cl, NO);
 	}
+	
+	_invalidate_dispatch_generation();
 }
 
 /**
@@ -582,61 +1355,280 @@ OBJC_INLINE BOOL _drops_unrecognized_message(id obj, SEL selector){
 }
 
 /**
- * Calls class extension object_initializer functions.
+ * Object plan - what needs to be done to create and destroy an instance
+ * of a class, so that it isn't necessary to walk all the class extensions
+ * each time. The extensions can't change once the run-time is initialized
+ * and the instance size is fixed when the class gets finished, hence the
+ * plan is built once, when it's first needed.
+ *
+ * size - size of the instance, including the extra space of extensions.
+ * allocator - the allocator chosen for the class.
+ * initializers, destructors - only those of the extensions that have them,
+ *	with offsets of their extra space from the beginning of the object.
+ * deallocator_lookups - object_deallocator_for_object functions of the
+ *	extensions, as the deallocator may differ object to object.
+ *	If there are none, objc_dealloc is used.
+ *
+ * The arrays are allocated along with the structure.
  */
-OBJC_INLINE void _complete_object(id obj) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void _complete_object(id obj){
-	objc_class_extension *ext = class_extensions;
-	void *obj_ext_beginning = objc_object_extensions_beginning(obj);
-	while (ext != NULL){
-		if (ext->object_initializer != NULL){
-			ext->object_initializer(obj, (void*)((char*)obj_ext_beginning + ext->object_extra_space_offset));
+typedef struct {
+	void(*function)(id, void*);
+	unsigned int offset;
+} _object_plan_callback;
+
+typedef objc_deallocator_f(*_object_plan_deallocator_lookup_f)(id, unsigned int);
+
+struct objc_object_plan {
+	unsigned int size;
+	unsigned int initializer_count;
+	unsigned int destructor_count;
+	unsigned int deallocator_lookup_count;
+	objc_allocator_f allocator;
+	_object_plan_callback *initializers;
+	_object_plan_callback *destructors;
+	_object_plan_deallocator_lookup_f *deallocator_lookups;
+};
+
+/**
+ * Returns the allocator for class. If a class extension
+ * returns a valid allocator, then it is returned.
+ * Otherwise objc_zero_alloc.
+ */
+OBJC_INLINE objc_allocator_f _allocator_for_class(Class cl, unsigned int size) OBJC_ALWAYS_INLINE;
+OBJC_INLINE objc_allocator_f _allocator_for_class(Class cl, unsigned int size){
+	objc_allocator_f allocator = objc_zero_alloc;
+	objc_class_extension *ext;
+	
+	ext = class_extensions;
+	while (ext != NULL) {
+		objc_allocator_f ext_allocator;
+		if (ext->object_allocator_for_class != NULL){
+			ext_allocator = ext->object_allocator_for_class(cl, size);
+			if (ext_allocator != NULL){
+				allocator = ext_allocator;
+				break;
+			}
 		}
 		ext = ext->next_extension;
 	}
+	
+	return allocator;
 }
 
-/**
- * Calls class extension object_deallocator functions.
- */
-OBJC_INLINE void _finalize_object(id obj) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void _finalize_object(id obj){
+static struct objc_object_plan *_object_plan_create(Class cl){
+	struct objc_object_plan *plan;
 	objc_class_extension *ext;
-	void *obj_ext_beginning = objc_object_extensions_beginning(obj);
-	ext = class_extensions;
-	while (ext != NULL){
+	unsigned int initializer_count = 0;
+	unsigned int destructor_count = 0;
+	unsigned int deallocator_lookup_count = 0;
+	
+	for (ext = class_extensions; ext != NULL; ext = ext->next_extension){
+		initializer_count += (ext->object_initializer != NULL);
+		destructor_count += (ext->object_destructor != NULL);
+		deallocator_lookup_count += (ext->object_deallocator_for_object != NULL);
+	}
+	
+	plan = objc_zero_alloc(sizeof(struct objc_object_plan)
+			       + (initializer_count + destructor_count) * sizeof(_object_plan_callback)
+			       + deallocator_lookup_count * sizeof(_object_plan_deallocator_lookup_f));
+	plan->initializers = (_object_plan_callback*)(plan + 1);
+	plan->destructors = plan->initializers + initializer_count;
+	plan->deallocator_lookups = (_object_plan_deallocator_lookup_f*)(plan->destructors + destructor_count);
+	plan->size = _instance_size(cl);
+	plan->allocator = _allocator_for_class(cl, plan->size);
+	
+	/* Keeps the order of the extension list. */
+	for (ext = class_extensions; ext != NULL; ext = ext->next_extension){
+		unsigned int offset = cl->instance_size + ext->object_extra_space_offset;
+		if (ext->object_initializer != NULL){
+			plan->initializers[plan->initializer_count].function = ext->object_initializer;
+			plan->initializers[plan->initializer_count].offset = offset;
+			++plan->initializer_count;
+		}
 		if (ext->object_destructor != NULL){
-			ext->object_destructor(obj, (void*)((char*)obj_ext_beginning + ext->object_extra_space_offset));
+			plan->destructors[plan->destructor_count].function = ext->object_destructor;
+			plan->destructors[plan->destructor_count].offset = offset;
+			++plan->destructor_count;
 		}
-		ext = ext->next_extension;
+		if (ext->object_deallocator_for_object != NULL){
+			plan->deallocator_lookups[plan->deallocator_lookup_count++] = ext->object_deallocator_for_object;
+		}
+	}
+	
+	return plan;
+}
+
+/**
+ * Returns the object plan of a finished class, creating it if necessary.
+ */
+OBJC_INLINE struct objc_object_plan *_object_plan_for_class(Class cl) OBJC_ALWAYS_INLINE;
+OBJC_INLINE struct objc_object_plan *_object_plan_for_class(Class cl){
+	struct objc_object_plan *plan = objc_atomic_load_acquire(&cl->object_plan);
+	if (plan == NULL){
+		plan = _object_plan_create(cl);
+		if (!objc_atomic_compare_and_swap(&cl->object_plan, NULL, plan)){
+			/* Someone else has been faster. */
+			objc_dealloc(plan);
+			plan = objc_atomic_load_acquire(&cl->object_plan);
+		}
+	}
+	return plan;
+}
+
+/**
+ * Calls class extension object_initializer functions.
+ */
+OBJC_INLINE void _complete_object_with_plan(id obj, struct objc_object_plan *plan) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _complete_object_with_plan(id obj, struct objc_object_plan *plan){
+	unsigned int i;
+	for (i = 0; i < plan->initializer_count; ++i){
+		plan->initializers[i].function(obj, (char*)obj + plan->initializers[i].offset);
+	}
+}
+
+/**
+ * Calls class extension object_destructor functions.
+ */
+OBJC_INLINE void _finalize_object_with_plan(id obj, struct objc_object_plan *plan) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _finalize_object_with_plan(id obj, struct objc_object_plan *plan){
+	unsigned int i;
+	for (i = 0; i < plan->destructor_count; ++i){
+		plan->destructors[i].function(obj, (char*)obj + plan->destructors[i].offset);
 	}
 }
 
+/**
+ * Returns the deallocator for obj. If a class extension
+ * returns a valid deallocator, then it is returned.
+ * Otherwise objc_dealloc.
+ */
+OBJC_INLINE objc_deallocator_f _deallocator_with_plan(id obj, struct objc_object_plan *plan) OBJC_ALWAYS_INLINE;
+OBJC_INLINE objc_deallocator_f _deallocator_with_plan(id obj, struct objc_object_plan *plan){
+	unsigned int i;
+	for (i = 0; i < plan->deallocator_lookup_count; ++i){
+		objc_deallocator_f deallocator = plan->deallocator_lookups[i](obj, plan->size);
+		if (deallocator != NULL){
+			return deallocator;
+		}
+	}
+	return objc_dealloc;
+}
+
 /**
  * Looks for an ivar named name in ivar_list.
  */
 OBJC_INLINE Ivar _ivar_named_in_ivar_list(objc_array ivar_list, const char *name) OBJC_ALWAYS_INLINE;
 OBJC_INLINE Ivar _ivar_named_in_ivar_list(objc_array ivar_list, const char *name){
-	objc_array_enumerator en;
+	Ivar *ivars;
+	unsigned int count;
+	unsigned int i;
 	
 	if (ivar_list == NULL){
 		return NULL;
 	}
 	
-	en = objc_array_get_enumerator(ivar_list);
-	while (en != NULL) {
-		Ivar ivar = en->item;
-		if (objc_strings_equal(name, ivar->name)){
-			return ivar;
+	ivars = (Ivar*)objc_array_get_items(ivar_list, &count);
+	for (i = 0; i < count; ++i){
+		if (objc_strings_equal(name, ivars[i]->name)){
+			return ivars[i];
 		}
-		en = en->next;
 	}
 	
 	return NULL;
 }
 
 /**
- * Finds an Ivar in class with name.
+ * Ivar index - an open-addressed hash table of all the ivars
+ * of a class, including those of its superclasses, keyed by name.
+ * As ivars can only be added while the class is in construction,
+ * the index never changes once built.
+ *
+ * mask - number of slots - 1.
+ * entries - the slots. A slot with NULL ivar is empty.
+ */
+typedef struct {
+	unsigned int hash;
+	Ivar ivar;
+} _ivar_index_entry;
+
+struct objc_ivar_index {
+	unsigned int mask;
+	_ivar_index_entry entries[];
+};
+
+/**
+ * Returns the slot of the ivar named name, or the empty slot where it belongs.
+ * The names are interned, hence a name passed by the run-time itself
+ * usually matches by the pointer.
+ */
+OBJC_INLINE _ivar_index_entry *_ivar_index_entry_for_name(struct objc_ivar_index *index, const char *name, unsigned int hash) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _ivar_index_entry *_ivar_index_entry_for_name(struct objc_ivar_index *index, const char *name, unsigned int hash){
+	_ivar_index_entry *entries = index->entries;
+	unsigned int i = hash & index->mask;
+	
+	while (entries[i].ivar != NULL){
+		if (entries[i].ivar->name == name || (entries[i].hash == hash && objc_strings_equal(entries[i].ivar->name, name))){
+			break;
+		}
+		i = (i + 1) & index->mask;
+	}
+	return &entries[i];
+}
+
+/**
+ * Creates the ivar index of cl. Ivars of subclasses come first,
+ * so that they'd hide ivars of the same name of superclasses,
+ * just like with _ivar_named_in_ivar_list.
+ */
+OBJC_INLINE struct objc_ivar_index *_ivar_index_create(Class cl) OBJC_ALWAYS_INLINE;
+OBJC_INLINE struct objc_ivar_index *_ivar_index_create(Class cl){
+	struct objc_ivar_index *index;
+	unsigned int count = 0;
+	unsigned int slot_count = 4;
+	Class c;
+	
+	for (c = cl; c != Nil; c = c->super_class){
+		if (c->ivars != NULL){
+			unsigned int ivar_count;
+			objc_array_get_items(c->ivars, &ivar_count);
+			count += ivar_count;
+		}
+	}
+	
+	/* At most half full. */
+	while (slot_count < count * 2){
+		slot_count *= 2;
+	}
+	
+	index = objc_zero_alloc(sizeof(struct objc_ivar_index) + slot_count * sizeof(_ivar_index_entry));
+	index->mask = slot_count - 1;
+	
+	for (c = cl; c != Nil; c = c->super_class){
+		Ivar *ivars;
+		unsigned int ivar_count;
+		unsigned int i;
+		
+		if (c->ivars == NULL){
+			continue;
+		}
+		
+		ivars = (Ivar*)objc_array_get_items(c->ivars, &ivar_count);
+		for (i = 0; i < ivar_count; ++i){
+			unsigned int hash = objc_hash_string(ivars[i]->name);
+			_ivar_index_entry *entry = _ivar_index_entry_for_name(index, ivars[i]->name, hash);
+			if (entry->ivar == NULL){
+				entry->hash = hash;
+				entry->ivar = ivars[i];
+			}
+		}
+	}
+	
+	return index;
+}
+
+/**
+ * Finds an Ivar in class with name. Until the class gets finished,
+ * its ivar lists get searched, then the superclass' index is used.
  */
 OBJC_INLINE Ivar _ivar_named(Class cl, const char *name) OBJC_ALWAYS_INLINE;
 OBJC_INLINE Ivar _ivar_named(Class cl, const char *name){
@@ -645,7 +1637,13 @@ OBJC_INLINE Ivar _ivar_named(Class cl, const char *name){
 	}
 	
 	while (cl != Nil){
-		Ivar var = _ivar_named_in_ivar_list(cl->ivars, name);
+		Ivar var;
+		
+		if (cl->ivar_index != NULL){
+			return _ivar_index_entry_for_name(cl->ivar_index, name, objc_hash_string(name))->ivar;
+		}
+		
+		var = _ivar_named_in_ivar_list(cl->ivars, name);
 		if (var != NULL){
 			return var;
 		}
@@ -661,17 +1659,12 @@ OBJC_INLINE Ivar _ivar_named(Class cl, const char *name){
 OBJC_INLINE unsigned int _ivar_count(Class cl) OBJC_ALWAYS_INLINE;
 OBJC_INLINE unsigned int _ivar_count(Class cl){
 	unsigned int count = 0;
-	objc_array_enumerator en;
 	objc_array ivar_list = cl->ivars;
 	if (ivar_list == NULL){
 		return count;
 	}
 	
-	en = objc_array_get_enumerator(ivar_list);
-	while (en != NULL) {
-		++count;
-		en = en->next;
-	}
+	objc_array_get_items(ivar_list, &count);
 	return count;
 }
 
@@ -680,20 +1673,19 @@ OBJC_INLINE unsigned int _ivar_count(Class cl){
  */
 OBJC_INLINE void _ivars_copy_to_list(Class cl, Ivar *list, unsigned int max_count) OBJC_ALWAYS_INLINE;
 OBJC_INLINE void _ivars_copy_to_list(Class cl, Ivar *list, unsigned int max_count){
-	unsigned int counter = 0;
+	unsigned int counter;
+	unsigned int count;
 	objc_array ivar_list = cl->ivars;
-	objc_array_enumerator en;
+	Ivar *ivars;
 	if (ivar_list == NULL){
 		/* NULL-termination */
 		list[0] = NULL;
 		return;
 	}
 	
-	en = objc_array_get_enumerator(ivar_list);
-	while (en != NULL && counter < max_count) {
-		list[counter] = en->item;
-		++counter;
-		en = en->next;
+	ivars = (Ivar*)objc_array_get_items(ivar_list, &count);
+	for (counter = 0; counter < count && counter < max_count; ++counter){
+		list[counter] = ivars[counter];
 	}
 	
 	/* NULL termination */
@@ -703,58 +1695,73 @@ OBJC_INLINE void _ivars_copy_to_list(Class cl, Ivar *list, unsigned int max_coun
 /**
  * Looks up method. If obj is nil, returns the nil receiver method.
  *
- * If the method is not found, forwarding takes place.
+ * If the method is not found, forwarding takes place. The outcome
+ * of forwarding (the forwarded method, or the nil receiver method
+ * if the message got dropped) is cached in the forwarding cache
+ * of the class, so the forwarding methods are called just once
+ * per selector until the caches get flushed. Hence the forwarding
+ * decision should depend on the class and the selector only.
  */
 OBJC_INLINE Method _lookup_method(id obj, SEL selector) OBJC_ALWAYS_INLINE;
 OBJC_INLINE Method _lookup_method(id obj, SEL selector){
 	Method method = NULL;
+	objc_cache *cache;
+	objc_cache *forwarding_cache;
 	
 	if (obj == nil){
-		/** ++ to invalidate inline cache. */
-		++_objc_nil_receiver_method.version;
+		/* Nothing gets written here, nil messaging is a pure read. */
 		return &_objc_nil_receiver_method;
 	}
 	
+	if (OBJC_OBJ_IS_CLASS(obj)){
+		cache = &((Class)obj)->class_cache;
+		forwarding_cache = &((Class)obj)->class_forwarding_cache;
+	}else{
+		cache = &obj->isa->instance_cache;
+		forwarding_cache = &obj->isa->instance_forwarding_cache;
+	}
+	
+	method = _lookup_cached_method(cache, selector);
+	if (method != NULL){
+		return method;
+	}
+	
+	/*
+	 * Just like in _lookup_impl, a selector that has already been
+	 * forwarded, or dropped, doesn't need the class hierarchy searched.
+	 */
+	method = _lookup_cached_method(forwarding_cache, selector);
+	if (method != NULL){
+		return method;
+	}
+	
 	if (OBJC_OBJ_IS_CLASS(obj)){
 		/* Class method */
-		method = _lookup_cached_method(((Class)obj)->class_cache, selector);
-		if (method != NULL){
-			return method;
-		}
-		
 		method = _lookup_class_method((Class)obj, selector);
-		if (method != NULL){
-			_cache_method(&((Class)obj)->class_cache, method);
-		}
 	}else{
 		/* Instance method. */
-		method = _lookup_cached_method(obj->isa->instance_cache, selector);
-		if (method != NULL){
-			return method;
-		}
-		
 		method = _lookup_instance_method(obj->isa, selector);
-		if (method != NULL){
-			_cache_method(&obj->isa->instance_cache, method);
+	}
+	
+	if (method != NULL){
+		if (OBJC_OBJ_IS_CLASS(obj)){
+			_cache_method((Class)obj, YES, method);
+		}else{
+			_cache_method(obj->isa, NO, method);
 		}
-	}
-	
-	if (method == NULL){
+	}else{
 		/* Not found! Prepare for forwarding. */
 		Method forwarded_method = _forward_method_invocation(obj, selector);
 		if (forwarded_method != NULL){
 			/** The object returned a method 
 			 * that should be called instead.
 			 */
-			
-			/** ++ to invalidate inline cache. */
-			++forwarded_method->version;
+			_cache_method_for_selector(forwarding_cache, Nil, NO, selector, forwarded_method);
 			return forwarded_method;
 		}
 		
 		if (forwarded_method == NULL && _drops_unrecognized_message(obj, selector)){
-			/** ++ to invalidate inline cache. */
-			++_objc_nil_receiver_method.version;
+			_cache_method_for_selector(forwarding_cache, Nil, NO, selector, &_objc_nil_receiver_method);
 			return &_objc_nil_receiver_method;
 		}
 		
@@ -767,6 +1774,11 @@ OBJC_INLINE Method _lookup_method(id obj, SEL selector){
 
 /**
  * The same scenario as above, but in this case a call to the superclass.
+ *
+ * The lookup starts at sup->class, which makes it exactly the same
+ * lookup as a regular one on an instance of sup->class (or on
+ * sup->class itself). The result is hence cached in the caches
+ * of sup->class and gets invalidated by the very same flushes.
  */
 OBJC_INLINE Method _lookup_method_super(objc_super *sup, SEL selector) OBJC_ALWAYS_INLINE;
 OBJC_INLINE Method _lookup_method_super(objc_super *sup, SEL selector){
@@ -782,10 +1794,10 @@ OBJC_INLINE Method _lookup_method_super(objc_super *sup, SEL selector){
 	
 	if (OBJC_OBJ_IS_CLASS(sup->receiver)){
 		/* Class method */
-		method = _lookup_class_method(sup->class, selector);
+		method = _lookup_class_method_and_cache(sup->class, selector);
 	}else{
 		/* Instance method. */
-		method = _lookup_instance_method(sup->class, selector);
+		method = _lookup_instance_method_and_cache(sup->class, selector);
 	}
 	
 	if (method == NULL){
@@ -849,11 +1861,21 @@ OBJC_INLINE BOOL _validate_prototype(struct objc_class_prototype *prototype){
 		return NO;
 	}
 	
-	if (prototype->instance_cache != NULL || prototype->class_cache != NULL){
+	if (prototype->instance_cache != NULL || prototype->class_cache != NULL
+	    || prototype->instance_forwarding_cache != NULL || prototype->class_forwarding_cache != NULL){
 		objc_log("Trying to register a prototype of class %s that already has a non-NULL cache.\n", prototype->name);
 		return NO;
 	}
 	
+	if (prototype->first_subclass != NULL || prototype->next_sibling != NULL
+	    || prototype->class_method_table != NULL || prototype->instance_method_table != NULL
+	    || prototype->class_dispatch_table != NULL || prototype->instance_dispatch_table != NULL
+	    || prototype->ivar_index != NULL || prototype->display != NULL
+	    || prototype->object_plan != NULL){
+		objc_log("Trying to register a prototype of class %s that has non-NULL subclass links or method tables.\n", prototype->name);
+		return NO;
+	}
+	
 	if (prototype->version > OBJC_MAX_CLASS_VERSION_SUPPORTED){
 		objc_log("Trying to register a prototype of class %s of a future version (%u).\n", prototype->name, prototype->version);
 		return NO;
@@ -862,6 +1884,109 @@ OBJC_INLINE BOOL _validate_prototype(struct objc_class_prototype *prototype){
 	return YES;
 }
 
+/**
+ * Instance sizes are kept aligned to at least this, so that the extra
+ * space of class extensions and the ivars of subclasses are aligned.
+ */
+#define OBJC_INSTANCE_SIZE_ALIGNMENT ((unsigned int)sizeof(void*))
+
+/**
+ * Rounds offset up to alignment, which must be a power of two.
+ */
+OBJC_INLINE unsigned int _align_offset(unsigned int offset, unsigned int alignment) OBJC_ALWAYS_INLINE;
+OBJC_INLINE unsigned int _align_offset(unsigned int offset, unsigned int alignment){
+	if (alignment == 0){
+		return offset;
+	}
+	return (offset + (alignment - 1)) & ~(alignment - 1);
+}
+
+/**
+ * Rounds the instance size of cl up to the largest alignment of its ivars.
+ */
+OBJC_INLINE void _align_instance_size(Class cl) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _align_instance_size(Class cl){
+	unsigned int alignment = OBJC_INSTANCE_SIZE_ALIGNMENT;
+	unsigned int count = 0;
+	unsigned int i;
+	Ivar *ivars;
+	
+	if (cl->ivars != NULL){
+		ivars = (Ivar*)objc_array_get_items(cl->ivars, &count);
+		for (i = 0; i < count; ++i){
+			if (ivars[i]->alignment > alignment){
+				alignment = ivars[i]->alignment;
+			}
+		}
+	}
+	
+	cl->instance_size = _align_offset(cl->instance_size, alignment);
+}
+
+/**
+ * Returns YES if ivar a should be placed before ivar b - hot ivars
+ * go first, so that they share the cache line with isa if possible,
+ * then the ivars with larger alignment, so that there's no padding
+ * between ivars of the same group.
+ */
+OBJC_INLINE BOOL _ivar_layout_precedes(Ivar a, Ivar b) OBJC_ALWAYS_INLINE;
+OBJC_INLINE BOOL _ivar_layout_precedes(Ivar a, Ivar b){
+	if (a->hot != b->hot){
+		return a->hot;
+	}
+	return a->alignment > b->alignment;
+}
+
+/**
+ * Assigns new offsets to the ivars of class cl in construction,
+ * see objc_class_set_optimizes_ivar_layout. The ivar list
+ * keeps the declaration order.
+ */
+static void _optimize_ivar_layout(Class cl){
+	unsigned int offset = (cl->super_class == Nil) ? 0 : cl->super_class->instance_size;
+	unsigned int first = 0;
+	unsigned int count;
+	unsigned int i, o;
+	Ivar *ivars;
+	Ivar *layout;
+	
+	if (cl->ivars == NULL){
+		return;
+	}
+	
+	ivars = (Ivar*)objc_array_get_items(cl->ivars, &count);
+	if (cl->super_class == Nil && count > 0){
+		/* The isa ivar of a root class stays at the beginning. */
+		offset = ivars[0]->offset + ivars[0]->size;
+		first = 1;
+	}
+	
+	if (count - first < 2){
+		return;
+	}
+	
+	/* Stable insertion sort, classes don't have many ivars. */
+	layout = objc_alloc((count - first) * sizeof(Ivar));
+	for (i = first; i < count; ++i){
+		Ivar ivar = ivars[i];
+		o = i - first;
+		while (o > 0 && _ivar_layout_precedes(ivar, layout[o - 1])){
+			layout[o] = layout[o - 1];
+			--o;
+		}
+		layout[o] = ivar;
+	}
+	
+	for (i = 0; i < count - first; ++i){
+		offset = _align_offset(offset, layout[i]->alignment);
+		layout[i]->offset = offset;
+		offset += layout[i]->size;
+	}
+	cl->instance_size = offset;
+	
+	objc_dealloc(layout);
+}
+
 /**
  * Adds an ivar to class from ivar prototype list.
  */
@@ -878,12 +2003,17 @@ OBJC_INLINE void _add_ivars_from_prototype(Class cl, Ivar *ivars){
 	
 	cl->ivars = objc_array_create();
 	
+	/* The offsets are fixed by the prototype, they include the padding. */
 	while (*ivars != NULL) {
 		objc_array_append(cl->ivars, *ivars);
-		cl->instance_size += (*ivars)->size;
+		if ((*ivars)->offset + (*ivars)->size > cl->instance_size){
+			cl->instance_size = (*ivars)->offset + (*ivars)->size;
+		}
 		
 		++ivars;
 	}
+	
+	_align_instance_size(cl);
 }
 
 /**
@@ -914,24 +2044,35 @@ OBJC_INLINE Class _register_prototype(struct objc_class_prototype *prototype){
 	/**
 	 * What needs to be done:
 	 *
-	 * 1) Lookup and connect superclass.
+	 * 1) Lookup and connect superclass, build the display.
 	 * 2) Connect isa.
 	 * 3) Transform class method prototypes to objc_array.
-	 * 4) Ditto with instance methods.
-	 * 5) Add ivars and calculate instance size.
-	 * 6) Allocate extra space and register with extensions.
+	 * 4) Ditto with instance methods, build the method tables.
+	 * 5) Add ivars and calculate instance size, build the ivar index.
+	 * 6) Allocate extra space and register with extensions, build
+	 *    the dispatch tables with eager dispatch.
 	 * 7) Mark as not in construction.
-	 * 8) Add to the class lists.
+	 * 8) Link into the subclass tree and add to the class lists.
 	 */
 	
 	if (prototype->super_class_name != NULL){
 		cl->super_class = objc_class_holder_lookup(objc_classes, prototype->super_class_name);
 	}
 	
+	_build_class_display(cl);
+	
+	if (cl->super_class != Nil && cl->super_class->flags.eager_dispatch){
+		cl->flags.eager_dispatch = YES;
+	}
+	if (cl->flags.eager_dispatch){
+		objc_eager_dispatch_in_use = YES;
+	}
+	
 	cl->isa = cl;
 	
 	cl->class_methods = objc_method_transform_method_prototypes(prototype->class_methods);
 	cl->instance_methods = objc_method_transform_method_prototypes(prototype->instance_methods);
+	_build_method_tables_locked(cl);
 	
 	_add_ivars_from_prototype(cl, prototype->ivars);
 	
@@ -943,41 +2084,20 @@ OBJC_INLINE Class _register_prototype(struct objc_class_prototype *prototype){
 	}
 	
 	_register_class_with_extensions(cl);
+	_build_dispatch_table_locked(cl, YES, NO);
+	_build_dispatch_table_locked(cl, NO, NO);
 	
+	cl->ivar_index = _ivar_index_create(cl);
 	cl->flags.in_construction = NO;
 	
+	_link_class_to_superclass(cl);
+	
 	objc_class_holder_insert(objc_classes, cl);
 	objc_array_append(objc_classes_array, cl);
 	
 	return cl;
 }
 
-/**
- * Returns the allocator for class. If a class extension
- * returns a valid allocator, then it is returned.
- * Otherwise objc_zero_alloc.
- */
-OBJC_INLINE objc_allocator_f _allocator_for_class(Class cl, unsigned int size) OBJC_ALWAYS_INLINE;
-OBJC_INLINE objc_allocator_f _allocator_for_class(Class cl, unsigned int size){
-	objc_allocator_f allocator = objc_zero_alloc;
-	objc_class_extension *ext;
-	
-	ext = class_extensions;
-	while (ext != NULL) {
-		objc_allocator_f ext_allocator;
-		if (ext->object_allocator_for_class != NULL){
-			ext_allocator = ext->object_allocator_for_class(cl, size);
-			if (ext_allocator != NULL){
-				allocator = ext_allocator;
-				break;
-			}
-		}
-		ext = ext->next_extension;
-	}
-	
-	return allocator;
-}
-
 
 /***** PUBLIC FUNCTIONS *****/
 /* Documentation in the header file. */
@@ -1016,7 +2136,7 @@ IMP objc_class_replace_instance_method_implementation(Class cls, SEL name, IMP i
 		return NULL;
 	}
 	
-	m = _lookup_method_in_method_list(cls->instance_methods, name);
+	m = _lookup_method_in_class_methods(&cls->instance_method_table, cls->instance_methods, name);
 	if (m == NULL){
 		Method new_method = objc_method_create(name, types, imp);
 		_add_instance_methods(cls, &new_method, 1);
@@ -1026,13 +2146,14 @@ IMP objc_class_replace_instance_method_implementation(Class cls, SEL name, IMP i
 		 */
 	}else{
 		m->implementation = imp;
-		++m->version;
 		
 		/**
-		 * There's no need to flush any caches as the whole
-		 * Method pointer is cached -> hence the IMP
-		 * pointer changes even inside the cache.
+		 * The caches keep the IMP next to the selector,
+		 * hence the class and all its subclasses need
+		 * to have their caches flushed.
 		 */
+		_flush_caches_of_subclasses_of_class(cls, NO);
+		_invalidate_dispatch_generation();
 	}
 	return m == NULL ? NULL : m->implementation;
 }
@@ -1043,7 +2164,7 @@ IMP objc_class_replace_class_method_implementation(Class cls, SEL name, IMP imp,
 		return NULL;
 	}
 	
-	m = _lookup_method_in_method_list(cls->class_methods, name);
+	m = _lookup_method_in_class_methods(&cls->class_method_table, cls->class_methods, name);
 	if (m == NULL){
 		Method new_method = objc_method_create(name, types, imp);
 		_add_class_methods(cls, &new_method, 1);
@@ -1053,13 +2174,14 @@ IMP objc_class_replace_class_method_implementation(Class cls, SEL name, IMP imp,
 		 */
 	}else{
 		m->implementation = imp;
-		++m->version;
 		
 		/**
-		 * There's no need to flush any caches as the whole
-		 * Method pointer is cached -> hence the IMP
-		 * pointer changes even inside the cache.
+		 * The caches keep the IMP next to the selector,
+		 * hence the class and all its subclasses need
+		 * to have their caches flushed.
 		 */
+		_flush_caches_of_subclasses_of_class(cls, YES);
+		_invalidate_dispatch_generation();
 	}
 	return m == NULL ? NULL : m->implementation;
 }
@@ -1099,11 +2221,20 @@ Class objc_class_create(Class superclass, const char *name) {
 	newClass = (Class)(objc_alloc(sizeof(struct objc_class)));
 	newClass->isa = newClass; /* A loop to self to detect class method calls. */
 	newClass->super_class = superclass;
-	newClass->name = objc_strcpy(name);
+	newClass->name = (char*)objc_string_intern(name);
 	newClass->class_methods = NULL; /* Lazy-loading */
 	newClass->instance_methods = NULL; /* Lazy-loading */
 	newClass->instance_cache = NULL;
 	newClass->class_cache = NULL;
+	newClass->instance_forwarding_cache = NULL;
+	newClass->class_forwarding_cache = NULL;
+	newClass->class_method_table = NULL; /* Built in objc_class_finish */
+	newClass->instance_method_table = NULL;
+	newClass->class_dispatch_table = NULL;
+	newClass->instance_dispatch_table = NULL;
+	newClass->ivar_index = NULL; /* Built in objc_class_finish */
+	newClass->object_plan = NULL; /* Built with the first instance */
+	_build_class_display(newClass);
 	newClass->ivars = NULL;
 	
 	/*
@@ -1116,6 +2247,8 @@ Class objc_class_create(Class superclass, const char *name) {
 	}
 	
 	newClass->flags.in_construction = YES;
+	newClass->flags.eager_dispatch = (superclass != Nil && superclass->flags.eager_dispatch);
+	newClass->flags.optimizes_ivar_layout = NO;
 	
 	extra_space = _extra_class_space_for_extensions();
 	if (extra_space != 0){
@@ -1124,6 +2257,8 @@ Class objc_class_create(Class superclass, const char *name) {
 		newClass->extra_space = NULL;
 	}
 	
+	_link_class_to_superclass(newClass);
+	
 	objc_class_holder_insert(objc_classes, newClass);
 	objc_array_append(objc_classes_array, newClass);
 	
@@ -1137,11 +2272,53 @@ void objc_class_finish(Class cl){
 		return;
 	}
 	
+	if (cl->flags.optimizes_ivar_layout){
+		_optimize_ivar_layout(cl);
+	}
+	_align_instance_size(cl);
+	
 	_register_class_with_extensions(cl);
 	
+	objc_rw_lock_wlock(objc_runtime_lock);
+	_build_method_tables_locked(cl);
+	_build_dispatch_table_locked(cl, YES, NO);
+	_build_dispatch_table_locked(cl, NO, NO);
+	objc_rw_lock_unlock(objc_runtime_lock);
+	
+	if (cl->ivar_index == NULL){
+		cl->ivar_index = _ivar_index_create(cl);
+	}
+	
 	/* That's it! Just mark it as not in construction */
 	cl->flags.in_construction = NO;
 }
+void objc_class_set_eager_dispatch(Class cl, BOOL eager){
+	if (cl == Nil){
+		return;
+	}
+	
+	if (!cl->flags.in_construction){
+		objc_log("Cannot change eager dispatch of class %s, which has already been finished.\n", cl->name);
+		return;
+	}
+	
+	cl->flags.eager_dispatch = eager;
+	if (eager){
+		objc_eager_dispatch_in_use = YES;
+	}
+}
+void objc_class_set_optimizes_ivar_layout(Class cl, BOOL optimize){
+	if (cl == Nil){
+		return;
+	}
+	
+	if (!cl->flags.in_construction){
+		objc_log("Cannot change the ivar layout of class %s, which has already been finished.\n", cl->name);
+		return;
+	}
+	
+	cl->flags.optimizes_ivar_layout = optimize;
+}
 
 #pragma mark -
 #pragma mark Responding to selectors
@@ -1161,10 +2338,15 @@ Method objc_lookup_class_method(Class cl, SEL selector){
 	return _lookup_class_method(cl, selector);
 }
 IMP objc_lookup_class_method_impl(Class cl, SEL selector){
+	IMP imp;
+	
 	/** No forwarding here! This is simply to lookup 
 	 * a method implementation.
 	 */
-	return _lookup_class_method_impl(cl, selector);
+	objc_reclaim_enter();
+	imp = _lookup_class_method_impl(cl, selector);
+	objc_reclaim_exit();
+	return imp;
 }
 Method objc_lookup_instance_method(id obj, SEL selector){
 	if (obj == nil){
@@ -1173,10 +2355,16 @@ Method objc_lookup_instance_method(id obj, SEL selector){
 	return _lookup_instance_method(obj->isa, selector);
 }
 IMP objc_lookup_instance_method_impl(id obj, SEL selector){
+	IMP imp;
+	
 	if (obj == nil){
 		return NULL;
 	}
-	return _lookup_instance_method_impl(obj->isa, selector);
+	
+	objc_reclaim_enter();
+	imp = _lookup_instance_method_impl(obj->isa, selector);
+	objc_reclaim_exit();
+	return imp;
 }
 
 #pragma mark -
@@ -1189,6 +2377,9 @@ Class objc_object_set_class(id obj, Class new_class){
 	}
 	old_class = obj->isa;
 	obj->isa = new_class;
+	
+	/* Anything cached for obj is now the wrong class' method. */
+	_invalidate_dispatch_generation();
 	return old_class;
 }
 
@@ -1196,77 +2387,175 @@ Class objc_object_set_class(id obj, Class new_class){
 #pragma mark Object creation, copying and destruction
 
 id objc_class_create_instance(Class cl){
+	struct objc_object_plan *plan;
 	id obj;
-	objc_allocator_f allocator;
-	unsigned int size;
 	
 	if (cl->flags.in_construction){
 		objc_log("Trying to create an instance of unfinished class (%s).", cl->name);
 		return nil;
 	}
 	
-	size = _instance_size(cl);
-	allocator = _allocator_for_class(cl, size);
+	plan = _object_plan_for_class(cl);
 	
-	obj = (id)allocator(size);
+	obj = (id)plan->allocator(plan->size);
 	obj->isa = cl;
 	
-	_complete_object(obj);
+	_complete_object_with_plan(obj, plan);
 	
 	return obj;
 }
+void objc_class_create_instances(Class cl, unsigned int count, id *instances){
+	struct objc_object_plan *plan;
+	objc_allocator_f allocator;
+	unsigned int size;
+	unsigned int i;
+	
+	if (cl->flags.in_construction){
+		objc_log("Trying to create instances of unfinished class (%s).", cl->name);
+		for (i = 0; i < count; ++i){
+			instances[i] = nil;
+		}
+		return;
+	}
+	
+	plan = _object_plan_for_class(cl);
+	allocator = plan->allocator;
+	size = plan->size;
+	
+	for (i = 0; i < count; ++i){
+		instances[i] = (id)allocator(size);
+		instances[i]->isa = cl;
+	}
+	
+	if (plan->initializer_count != 0){
+		for (i = 0; i < count; ++i){
+			_complete_object_with_plan(instances[i], plan);
+		}
+	}
+}
 void objc_object_deallocate(id obj){
-	objc_deallocator_f deallocator = objc_dealloc;
-	objc_class_extension *ext;
-	unsigned int size_of_obj;
+	struct objc_object_plan *plan;
 	
 	if (obj == nil){
 		return;
 	}
 	
-	size_of_obj = _instance_size(obj->isa) + _extra_object_space_for_extensions();
+	plan = _object_plan_for_class(obj->isa);
 	
-	_finalize_object(obj);
+	_finalize_object_with_plan(obj, plan);
+	_deallocator_with_plan(obj, plan)(obj);
+}
+
+OBJC_INLINE unsigned long _object_class_key(void *obj) OBJC_ALWAYS_INLINE;
+OBJC_INLINE unsigned long _object_class_key(void *obj){
+	return (unsigned long)((id)obj)->isa;
+}
+
+/**
+ * Deallocates count objects of class cl, none of which is nil.
+ */
+OBJC_INLINE void _deallocate_objects_of_class(Class cl, id *objects, unsigned int count) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _deallocate_objects_of_class(Class cl, id *objects, unsigned int count){
+	struct objc_object_plan *plan = _object_plan_for_class(cl);
+	unsigned int i;
 	
-	ext = class_extensions;
-	while (ext != NULL) {
-		objc_deallocator_f ext_deallocator;
-		if (ext->object_deallocator_for_object != NULL){
-			ext_deallocator = ext->object_deallocator_for_object(obj, size_of_obj);
-			if (ext_deallocator != NULL){
-				deallocator = ext_deallocator;
-				break;
+	if (plan->destructor_count != 0){
+		for (i = 0; i < count; ++i){
+			_finalize_object_with_plan(objects[i], plan);
+		}
+	}
+	
+	if (plan->deallocator_lookup_count == 0){
+		for (i = 0; i < count; ++i){
+			objc_dealloc(objects[i]);
+		}
+	}else{
+		for (i = 0; i < count; ++i){
+			_deallocator_with_plan(objects[i], plan)(objects[i]);
+		}
+	}
+}
+
+void objc_objects_deallocate(id *objects, unsigned int count){
+	id *sorted;
+	id *buffer;
+	unsigned int live_count = 0;
+	unsigned int i;
+	BOOL single_class = YES;
+	
+	for (i = 0; i < count; ++i){
+		if (objects[i] != nil){
+			if (live_count != 0 && objects[i]->isa != objects[live_count - 1]->isa){
+				single_class = NO;
 			}
+			objects[live_count++] = objects[i];
 		}
-		ext = ext->next_extension;
 	}
 	
-	deallocator(obj);
+	if (live_count == 0){
+		return;
+	}
+	
+	if (single_class){
+		_deallocate_objects_of_class(objects[0]->isa, objects, live_count);
+		return;
+	}
+	
+	/* Groups the objects by class, so that each plan is only resolved once. */
+	buffer = objc_alloc(live_count * sizeof(id));
+	sorted = (id *)_sort_pointers_by_key((void **)objects, (void **)buffer, live_count, _object_class_key);
+	
+	i = 0;
+	while (i < live_count){
+		Class cl = sorted[i]->isa;
+		unsigned int end = i + 1;
+		
+		while (end < live_count && sorted[end]->isa == cl){
+			++end;
+		}
+		
+		_deallocate_objects_of_class(cl, sorted + i, end - i);
+		i = end;
+	}
+	
+	objc_dealloc(buffer);
 }
 
 id objc_object_copy(id obj){
+	struct objc_object_plan *plan;
 	id copy;
-	objc_allocator_f allocator;
-	unsigned int size;
 	
 	if (obj == nil){
 		return nil;
 	}
 	
-	size = _instance_size(obj->isa);
-	allocator = _allocator_for_class(obj->isa, size);
+	plan = _object_plan_for_class(obj->isa);
 	
-	copy = allocator(size);
+	copy = plan->allocator(plan->size);
 	
-	objc_copy_memory(obj, copy, size);
+	objc_copy_memory(obj, copy, plan->size);
 	
 	return copy;
 }
+BOOL objc_object_has_managed_lifetime(id obj){
+	objc_class_extension *ext;
+	
+	if (!objc_extensions_manage_lifetime || obj == nil){
+		return NO;
+	}
+	
+	for (ext = class_extensions; ext != NULL; ext = ext->next_extension){
+		if (ext->object_has_managed_lifetime != NULL && ext->object_has_managed_lifetime(obj)){
+			return YES;
+		}
+	}
+	return NO;
+}
 void objc_complete_object(id instance){
-	_complete_object(instance);
+	_complete_object_with_plan(instance, _object_plan_for_class(instance->isa));
 }
 void objc_finalize_object(id instance){
-	_finalize_object(instance);
+	_finalize_object_with_plan(instance, _object_plan_for_class(instance->isa));
 }
 
 
@@ -1274,17 +2563,91 @@ void objc_finalize_object(id instance){
 #pragma mark -
 #pragma mark Object lookup
 
+/**
+ * Looks up an implementation, trying the caches first. A hit in the
+ * regular cache doesn't need the Method structure at all.
+ *
+ * The forwarding cache is different - the forwarded method belongs to
+ * another class, whose implementation may get replaced without the
+ * forwarding caches being flushed. Hence its implementation is read
+ * from the Method each time.
+ */
+OBJC_INLINE IMP _lookup_impl(id obj, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE IMP _lookup_impl(id obj, SEL selector){
+	if (obj != nil){
+		IMP imp;
+		Method forwarded_method;
+		if (OBJC_OBJ_IS_CLASS(obj)){
+			imp = _lookup_cached_imp(&((Class)obj)->class_cache, selector);
+			if (imp != NULL){
+				return imp;
+			}
+			forwarded_method = _lookup_cached_method(&((Class)obj)->class_forwarding_cache, selector);
+		}else{
+			imp = _lookup_cached_imp(&obj->isa->instance_cache, selector);
+			if (imp != NULL){
+				return imp;
+			}
+			forwarded_method = _lookup_cached_method(&obj->isa->instance_forwarding_cache, selector);
+		}
+		if (forwarded_method != NULL){
+			return forwarded_method->implementation;
+		}
+	}
+	return _lookup_method(obj, selector)->implementation;
+}
+
+/**
+ * The same as above, but for a call to the superclass.
+ */
+OBJC_INLINE IMP _lookup_impl_super(objc_super *sup, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE IMP _lookup_impl_super(objc_super *sup, SEL selector){
+	if (sup != NULL && sup->receiver != nil && sup->class != Nil){
+		/* See _lookup_method_super for why sup->class's cache is used. */
+		IMP imp;
+		if (OBJC_OBJ_IS_CLASS(sup->receiver)){
+			imp = _lookup_cached_imp(&sup->class->class_cache, selector);
+		}else{
+			imp = _lookup_cached_imp(&sup->class->instance_cache, selector);
+		}
+		if (imp != NULL){
+			return imp;
+		}
+	}
+	return _lookup_method_super(sup, selector)->implementation;
+}
+
+/*
+ * The caches may get flushed by other threads while being read,
+ * hence all the lookups run within a reclamation section.
+ */
 Method objc_object_lookup_method(id obj, SEL selector){
-	return _lookup_method(obj, selector);
+	Method method;
+	objc_reclaim_enter();
+	method = _lookup_method(obj, selector);
+	objc_reclaim_exit();
+	return method;
 }
 Method objc_object_lookup_method_super(objc_super *sup, SEL selector){
-	return _lookup_method_super(sup, selector);
+	Method method;
+	objc_reclaim_enter();
+	method = _lookup_method_super(sup, selector);
+	objc_reclaim_exit();
+	return method;
 }
 IMP objc_object_lookup_impl(id obj, SEL selector){
-	return _lookup_method(obj, selector)->implementation;
+	IMP imp;
+	objc_reclaim_enter();
+	imp = _lookup_impl(obj, selector);
+	objc_reclaim_exit();
+	return imp;
 }
 IMP objc_object_lookup_impl_super(objc_super *sup, SEL selector){
-	return _lookup_method_super(sup, selector)->implementation;
+	IMP imp;
+	objc_reclaim_enter();
+	imp = _lookup_impl_super(sup, selector);
+	objc_reclaim_exit();
+	return imp;
 }
 
 /***** INFORMATION GETTERS *****/
@@ -1300,6 +2663,12 @@ const char *objc_class_get_name(Class cl){
 Class objc_class_get_superclass(Class cl){
 	return cl->super_class;
 }
+BOOL objc_class_is_subclass_of(Class cl, Class candidate){
+	if (cl == Nil || candidate == Nil){
+		return NO;
+	}
+	return candidate->depth <= cl->depth && cl->display[candidate->depth] == candidate;
+}
 Class objc_object_get_class(id obj){
 	return obj == nil ? Nil : obj->isa;
 }
@@ -1319,24 +2688,15 @@ Method *objc_class_get_instance_method_list(Class cl){
 	return objc_method_list_flatten(cl->instance_methods);
 }
 Class *objc_class_get_list(void){
-	unsigned int count = 0;
-	unsigned int i = 0;
-	objc_array_enumerator en;
+	unsigned int count;
+	unsigned int i;
+	Class *all_classes;
 	Class *classes;
 	
-	en = objc_array_get_enumerator(objc_classes_array);
-	while (en != NULL){
-		++count;
-		en = en->next;
-	}
-	
+	all_classes = (Class*)objc_array_get_items(objc_classes_array, &count);
 	classes = (Class*)objc_alloc(sizeof(Class) * (count + 1));
-	
-	en = objc_array_get_enumerator(objc_classes_array);
-	while (en != NULL && i < count) {
-		classes[i] = en->item;
-		++i;
-		en = en->next;
+	for (i = 0; i < count; ++i){
+		classes[i] = all_classes[i];
 	}
 	
 	/* NULL termination. */
@@ -1388,15 +2748,14 @@ Ivar objc_class_add_ivar(Class cls, const char *name, unsigned int size, unsigne
 	}
 	
 	variable = (Ivar)objc_alloc(sizeof(struct objc_ivar));
-	variable->name = objc_strcpy(name);
-	variable->type = objc_strcpy(types);
+	variable->name = objc_string_intern(name);
+	variable->type = objc_string_intern(types);
 	variable->size = size;
+	variable->alignment = (alignment == 0) ? 1 : alignment;
+	variable->hot = NO;
 	
 	/* The offset is the aligned end of the instance size. */
-	variable->offset = cls->instance_size;
-	if (alignment != 0 && (variable->offset % alignment) > 0){
-		variable->offset = (variable->offset + (alignment - 1)) & ~(alignment - 1);
-	}
+	variable->offset = _align_offset(cls->instance_size, alignment);
 	
 	cls->instance_size = variable->offset + size;
 	
@@ -1407,6 +2766,26 @@ Ivar objc_class_add_ivar(Class cls, const char *name, unsigned int size, unsigne
 	
 	return variable;
 }
+void objc_class_set_ivar_hot(Class cls, const char *name, BOOL hot){
+	Ivar ivar;
+	
+	if (cls == Nil || name == NULL){
+		return;
+	}
+	
+	if (!cls->flags.in_construction){
+		objc_log("Class %s isn't in construction!\n", cls->name);
+		return;
+	}
+	
+	ivar = _ivar_named_in_ivar_list(cls->ivars, name);
+	if (ivar == NULL){
+		objc_log("Class %s doesn't declare an ivar named %s!\n", cls->name, name);
+		return;
+	}
+	
+	ivar->hot = hot;
+}
 Ivar objc_class_get_ivar(Class cls, const char *name){
 	return _ivar_named(cls, name);
 }
@@ -1467,6 +2846,32 @@ void objc_object_set_variable(id obj, Ivar ivar, void *value){
 	objc_copy_memory(value, (char*)obj + ivar->offset, ivar->size);
 }
 
+/**
+ * Typed accessors. The value is read or written directly,
+ * the ivar is expected to be of the size and aligned.
+ */
+#define OBJC_IVAR_ACCESSORS(SUFFIX, TYPE) \
+	TYPE objc_object_get_variable_##SUFFIX(id obj, Ivar ivar){\
+		if (obj == nil || ivar == NULL){\
+			return (TYPE)0;\
+		}\
+		return *(TYPE*)((char*)obj + ivar->offset);\
+	}\
+	void objc_object_set_variable_##SUFFIX(id obj, Ivar ivar, TYPE value){\
+		if (obj == nil || ivar == NULL){\
+			return;\
+		}\
+		*(TYPE*)((char*)obj + ivar->offset) = value;\
+	}
+
+OBJC_IVAR_ACCESSORS(8, uint8_t)
+OBJC_IVAR_ACCESSORS(16, uint16_t)
+OBJC_IVAR_ACCESSORS(32, uint32_t)
+OBJC_IVAR_ACCESSORS(64, uint64_t)
+OBJC_IVAR_ACCESSORS(pointer, void*)
+
+#undef OBJC_IVAR_ACCESSORS
+
 /***** PROTOTYPE-RELATED *****/
 #pragma mark -
 #pragma mark Prototype-related
@@ -1518,6 +2923,10 @@ void objc_class_add_extension(objc_class_extension *extension){
 		extension->next_extension = class_extensions;
 		class_extensions = extension;
 	}
+	
+	if (extension->object_has_managed_lifetime != NULL){
+		objc_extensions_manage_lifetime = YES;
+	}
 }
 
 /**** CACHE-RELATED ****/
@@ -1544,20 +2953,63 @@ void objc_class_flush_caches(Class cl){
 		return;
 	}
 	
+	_drop_dispatch_tables_in_subtree(cl, YES);
+	_drop_dispatch_tables_in_subtree(cl, NO);
 	_flush_cache(&cl->class_cache);
 	_flush_cache(&cl->instance_cache);
+	_flush_cache(&cl->class_forwarding_cache);
+	_flush_cache(&cl->instance_forwarding_cache);
+	_rebuild_dispatch_tables_in_subtree(cl, YES);
+	_rebuild_dispatch_tables_in_subtree(cl, NO);
+	_invalidate_dispatch_generation();
 }
 void objc_class_flush_instance_cache(Class cl){
 	if (cl == Nil){
 		return;
 	}
+	_drop_dispatch_tables_in_subtree(cl, NO);
 	_flush_cache(&cl->instance_cache);
+	_flush_cache(&cl->instance_forwarding_cache);
+	_rebuild_dispatch_tables_in_subtree(cl, NO);
+	_invalidate_dispatch_generation();
 }
 void objc_class_flush_class_cache(Class cl){
 	if (cl == Nil){
 		return;
 	}
+	_drop_dispatch_tables_in_subtree(cl, YES);
 	_flush_cache(&cl->class_cache);
+	_flush_cache(&cl->class_forwarding_cache);
+	_rebuild_dispatch_tables_in_subtree(cl, YES);
+	_invalidate_dispatch_generation();
+}
+
+/**
+ * Fills statistics of cache, or zeroes them if there's no cache.
+ */
+OBJC_INLINE void _get_cache_statistics(objc_cache *cache_ptr, objc_cache_statistics *statistics) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _get_cache_statistics(objc_cache *cache_ptr, objc_cache_statistics *statistics){
+	objc_cache cache;
+	
+	if (statistics == NULL){
+		return;
+	}
+	
+	objc_reclaim_enter();
+	cache = cache_ptr == NULL ? NULL : objc_atomic_load_acquire(cache_ptr);
+	if (cache == NULL){
+		objc_memory_zero(statistics, sizeof(objc_cache_statistics));
+	}else{
+		objc_cache_get_statistics(cache, statistics);
+	}
+	objc_reclaim_exit();
+}
+
+void objc_class_get_instance_cache_statistics(Class cl, objc_cache_statistics *statistics){
+	_get_cache_statistics(cl == Nil ? NULL : &cl->instance_cache, statistics);
+}
+void objc_class_get_class_cache_statistics(Class cl, objc_cache_statistics *statistics){
+	_get_cache_statistics(cl == Nil ? NULL : &cl->class_cache, statistics);
 }
 
 /***** INITIALIZATION *****/
@@ -7,6 +7,7 @@
 #define OBJC_CLASS_H_
 
 #include "types.h" /* For Class, BOOL, Method, ... definitions. */
+#include <stdint.h> /* For the typed ivar accessors. */
 
 /**
  * Two simple macros that determine whether the object is
@@ -70,6 +71,34 @@ extern Class objc_class_create(Class superclass, const char *name);
  */
 extern void objc_class_finish(Class cl);
 
+/**
+ * Turns on eager dispatch for a class in construction. When such
+ * a class gets finished, all the methods it responds to, including
+ * the inherited ones and those of class extensions, are merged into
+ * a dispatch table and its caches are filled from it right away,
+ * so that the first sends don't need to search the class hierarchy.
+ * A cache miss is then resolved by a single table search. The tables
+ * get rebuilt whenever the caches of the class get flushed.
+ *
+ * Subclasses of such a class use eager dispatch as well. Prototypes
+ * may turn it on by setting flags.eager_dispatch.
+ */
+extern void objc_class_set_eager_dispatch(Class cl, BOOL eager);
+
+/**
+ * Turns on ivar layout optimization for a class in construction. When
+ * such a class gets finished, its ivars get new offsets - the hot ones
+ * (see objc_class_set_ivar_hot) first, so that they share the cache line
+ * with isa if possible, then the rest, each group ordered by decreasing
+ * alignment to minimize the padding. The isa ivar of a root class is
+ * expected to be added first and keeps its offset.
+ *
+ * The offsets of such a class' ivars are hence only final once the class
+ * gets finished. Each class decides on its own, subclasses don't inherit
+ * this, as their ivars are placed after those of the superclass anyway.
+ */
+extern void objc_class_set_optimizes_ivar_layout(Class cl, BOOL optimize);
+
 
 
 #pragma mark -
@@ -117,6 +146,11 @@ extern BOOL objc_class_responds_to_class_selector(Class cl, SEL selector);
  * the program is aborted. If it returns YES, a no-op function pointer
  * is returned.
  *
+ * The outcome of the forwarding is cached per class and selector
+ * in a separate forwarding cache (which gets flushed along with
+ * the regular caches), so the forwarding methods get called only
+ * on the first send of an unrecognized selector.
+ *
  * This is a simplified forwarding mechanism with less overhead. In case
  * the forwarding mechanism used by Apple and others is needed for
  * compatibility reasons, it can be easily implemented within this method.
@@ -152,6 +186,15 @@ extern Class objc_object_set_class(id obj, Class new_class);
  */
 extern id objc_class_create_instance(Class cl);
 
+/**
+ * Creates count instances of class cl and stores them in instances,
+ * just like calling objc_class_create_instance count times, except
+ * that the allocator and the class extensions are only resolved once.
+ *
+ * If the class is still in construction, instances is filled with nil.
+ */
+extern void objc_class_create_instances(Class cl, unsigned int count, id *instances);
+
 /**
  * If, for whatever reason, you do not use the run-time function
  * to create an instance (see above), always *do* call the finalize function
@@ -174,6 +217,22 @@ extern void objc_complete_object(id instance);
  */
 extern void objc_object_deallocate(id obj);
 
+/**
+ * Deallocates count objects, just like calling objc_object_deallocate
+ * on each of them, though not necessarily in the same order. The objects
+ * are grouped by class, so that the class extensions are only resolved
+ * once for each class. The array may contain nil and its contents are
+ * undefined afterwards.
+ */
+extern void objc_objects_deallocate(id *objects, unsigned int count);
+
+/**
+ * Returns YES if a class extension manages the lifetime of obj.
+ * Reference counting classes should then ignore retain and release,
+ * the object gets deallocated by the extension.
+ */
+extern BOOL objc_object_has_managed_lifetime(id obj);
+
 /**
  * If, for whatever reason, you do not use the run-time function
  * to deallocate the object, you must call this function so that
@@ -231,6 +290,14 @@ extern const char *objc_class_get_name(Class cl);
  */
 extern Class objc_class_get_superclass(Class cl);
 
+/**
+ * Returns YES if cl is candidate, or a subclass of candidate. This
+ * doesn't walk the superclasses - each class keeps an array of its
+ * superclasses indexed by depth in the hierarchy, so the test is
+ * a bounds check and a single load.
+ */
+extern BOOL objc_class_is_subclass_of(Class cl, Class candidate);
+
 /**
  * Returns the class of the object, generally the isa pointer.
  */
@@ -278,11 +345,24 @@ extern Class objc_class_for_name(const char *name);
 /**
  * Adds an ivar to a class. If the class is not in construction,
  * calling this function aborts the program.
+ *
+ * The alignment must be a power of two, or 0. When the class gets
+ * finished, its instance size is rounded up to the largest alignment
+ * of its ivars, or to the pointer size, whichever is larger.
  */
 extern Ivar objc_class_add_ivar(Class cls, const char *name, unsigned int size, unsigned int alignment, const char *types);
 
 /**
- * Returns an ivar for name.
+ * Marks an ivar declared on a class in construction as frequently
+ * accessed. This is only a hint for the ivar layout optimization,
+ * see objc_class_set_optimizes_ivar_layout.
+ */
+extern void objc_class_set_ivar_hot(Class cls, const char *name, BOOL hot);
+
+/**
+ * Returns an ivar for name. Once the class is finished,
+ * this is a single lookup in a hash table of all the ivars
+ * of the class and its superclasses.
  */
 extern Ivar objc_class_get_ivar(Class cls, const char *name);
 
@@ -314,6 +394,26 @@ extern Ivar objc_object_set_variable_named(id obj, const char *name, void *value
 extern void objc_object_set_variable(id obj, Ivar ivar, void *value);
 extern void *objc_object_get_variable(id object, Ivar ivar);
 
+/**
+ * Typed variants of the previous functions for ivars of 1, 2, 4
+ * and 8 bytes and pointers. The value is read or written directly
+ * instead of being copied byte by byte, hence the ivar must be
+ * of the size and aligned to it (see objc_class_add_ivar).
+ *
+ * The getters return 0 (NULL) if obj is nil or ivar is NULL.
+ */
+extern uint8_t objc_object_get_variable_8(id obj, Ivar ivar);
+extern uint16_t objc_object_get_variable_16(id obj, Ivar ivar);
+extern uint32_t objc_object_get_variable_32(id obj, Ivar ivar);
+extern uint64_t objc_object_get_variable_64(id obj, Ivar ivar);
+extern void *objc_object_get_variable_pointer(id obj, Ivar ivar);
+
+extern void objc_object_set_variable_8(id obj, Ivar ivar, uint8_t value);
+extern void objc_object_set_variable_16(id obj, Ivar ivar, uint16_t value);
+extern void objc_object_set_variable_32(id obj, Ivar ivar, uint32_t value);
+extern void objc_object_set_variable_64(id obj, Ivar ivar, uint64_t value);
+extern void objc_object_set_variable_pointer(id obj, Ivar ivar, void *value);
+
 
 #pragma mark -
 #pragma mark Prototype-related
@@ -357,4 +457,12 @@ extern void objc_class_flush_caches(Class cl);
 extern void objc_class_flush_instance_cache(Class cl);
 extern void objc_class_flush_class_cache(Class cl);
 
+/**
+ * Fills statistics with the statistics of the appropriate cache
+ * of the class. If the cache hasn't been created yet, all fields
+ * are zero.
+ */
+extern void objc_class_get_instance_cache_statistics(Class cl, objc_cache_statistics *statistics);
+extern void objc_class_get_class_cache_statistics(Class cl, objc_cache_statistics *statistics);
+
 #endif /* OBJC_CLASS_H_ */
@@ -38,15 +38,25 @@ id _I_MRObject_init_(MRObject_instance_t *self, SEL _cmd){
 }
 
 id _I_MRObject_retain_(MRObject_instance_t *self, SEL _cmd){
+	if (objc_object_has_managed_lifetime((id)self)){
+		/** E.g. objects in a region live until the region gets popped. */
+		return (id)self;
+	}
+	
 	/** Warning, this atomic function is a GCC builtin function */
 	__sync_add_and_fetch(&self->retainCount, 1);
 	return (id)self;
 }
 
 void _I_MRObject_release_(MRObject_instance_t *self, SEL _cmd){
-	/** TODO atomic */
+	int retain_cnt;
+	
+	if (objc_object_has_managed_lifetime((id)self)){
+		/** E.g. objects in a region live until the region gets popped. */
+		return;
+	}
 	
-	int retain_cnt = __sync_sub_and_fetch(&self->retainCount, 1);
+	retain_cnt = __sync_sub_and_fetch(&self->retainCount, 1);
 	if (retain_cnt == 0){
 		/** Dealloc */
 		static SEL dealloc_selector;
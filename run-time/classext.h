@@ -32,6 +32,9 @@ typedef struct _objc_class_extension {
 	 *
 	 * Note that the memory returned *should* be zero'ed
 	 * out. If it is not, the run-time will not zero it.
+	 *
+	 * The allocator is only asked for once per class and
+	 * then used for all its instances.
 	 */
 	objc_allocator_f(*object_allocator_for_class)(Class, unsigned int);
 	
@@ -45,6 +48,14 @@ typedef struct _objc_class_extension {
 	 */
 	objc_deallocator_f(*object_deallocator_for_object)(id, unsigned int);
 	
+	/**
+	 * Returns YES if the extension manages the lifetime of obj,
+	 * e.g. if obj is deallocated along with other objects, so that
+	 * reference counting classes may ignore retain and release.
+	 * See objc_object_has_managed_lifetime.
+	 */
+	BOOL(*object_has_managed_lifetime)(id);
+	
 	/**
 	 * This function is responsible for initializing
 	 * the extra space in the class. The second parameter
@@ -76,6 +87,19 @@ typedef struct _objc_class_extension {
 	Method(*instance_lookup_function)(Class, SEL);
 	Method(*class_lookup_function)(Class, SEL);
 	
+	/**
+	 * These functions return all the methods the lookup functions
+	 * above may return for the class (not including its superclasses),
+	 * in the order the lookup functions search them. The list is
+	 * NULL-terminated and is deallocated by the run-time.
+	 *
+	 * They are needed for eager dispatch (see objc_class_set_eager_dispatch).
+	 * If an extension has a lookup function, but not the corresponding
+	 * function here, classes use the regular lookup instead.
+	 */
+	Method*(*instance_methods_function)(Class);
+	Method*(*class_methods_function)(Class);
+	
 	/**
 	 * Extra space in the class and object structures requested.
 	 * If the target architecture requires any alignments,
@@ -21,12 +21,11 @@ typedef struct {
 } ao_extension_object_part;
 
 static void _deallocate_ao_bucket(ao_bucket *bucket){
-	if (bucket->next == NULL){
-		return;
+	while (bucket != NULL){
+		ao_bucket *next = bucket->next;
+		objc_dealloc(bucket);
+		bucket = next;
 	}
-	
-	_deallocate_ao_bucket(bucket->next);
-	objc_dealloc(bucket);
 }
 
 static void _associated_object_deallocate(id obj, void *ptr){
@@ -51,6 +50,7 @@ void objc_associated_object_register_extension(void){
 	ao_extension.extra_object_space = sizeof(ao_extension_object_part);
 	ao_extension.instance_lookup_function = NULL;
 	ao_extension.object_destructor = _associated_object_deallocate;
+	ao_extension.object_has_managed_lifetime = NULL;
 	ao_extension.object_initializer = NULL; /* Lazy allocation */
 	
 	objc_class_add_extension(&ao_extension);
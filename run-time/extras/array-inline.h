@@ -2,68 +2,113 @@
 #ifndef _ARRAY_INLINE_H_
 #define _ARRAY_INLINE_H_
 
+/*
+ * Inline variant of structs/array.c - see there for the details.
+ */
+
 #include "../os.h"
+#include "../atomic.h"
+#include "../reclaim.h"
+
+#define ARRAY_INITIAL_CAPACITY 4
+
+typedef struct _array_storage_str {
+	struct _array_storage_str *previous;
+	unsigned int capacity;
+	unsigned int count;
+} *_array_storage;
 
 /* Internal representation of objc_array */
-typedef struct _array {
-	objc_rw_lock _lock;
-	objc_array_enumerator first;
-	objc_array_enumerator last;
+typedef struct _array_str {
+	_array_storage storage;
 } *_array;
 
-OBJC_INLINE void _array_destroy_enumerator(objc_array_enumerator enumerator) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void _array_destroy_enumerator(objc_array_enumerator enumerator){
-	if (enumerator == NULL){
-		return;
+OBJC_INLINE void **_array_storage_items(_array_storage storage) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void **_array_storage_items(_array_storage storage){
+	return (void**)(storage + 1);
+}
+
+OBJC_INLINE _array_storage _array_initial_storage(_array arr) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _array_storage _array_initial_storage(_array arr){
+	return (_array_storage)(arr + 1);
+}
+
+OBJC_INLINE void _array_grow(_array arr, _array_storage storage) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _array_grow(_array arr, _array_storage storage){
+	unsigned int capacity = storage->capacity * 2;
+	_array_storage new_storage = objc_zero_alloc(sizeof(struct _array_storage_str) + capacity * sizeof(void*));
+	unsigned int i;
+
+	/* The storage is full, hence no one is writing into it anymore. */
+	for (i = 0; i < storage->count; ++i){
+		_array_storage_items(new_storage)[i] = _array_storage_items(storage)[i];
+	}
+	new_storage->count = storage->count;
+	new_storage->capacity = capacity;
+	new_storage->previous = storage;
+
+	if (!objc_atomic_compare_and_swap(&arr->storage, storage, new_storage)){
+		/* Someone else has grown the array. */
+		objc_dealloc(new_storage);
 	}
-	
-	_array_destroy_enumerator(enumerator->next);
-	objc_dealloc(enumerator);
 }
 
 OBJC_INLINE objc_array objc_array_create(void) OBJC_ALWAYS_INLINE;
 OBJC_INLINE objc_array objc_array_create(void){
-	_array arr = objc_alloc(sizeof(struct _array));
-	arr->_lock = objc_rw_lock_create();
-	arr->first = NULL;
+	_array arr = objc_zero_alloc(sizeof(struct _array_str) + sizeof(struct _array_storage_str) + ARRAY_INITIAL_CAPACITY * sizeof(void*));
+	arr->storage = _array_initial_storage(arr);
+	arr->storage->capacity = ARRAY_INITIAL_CAPACITY;
 	return arr;
 }
 
 OBJC_INLINE void objc_array_destroy(objc_array array) OBJC_ALWAYS_INLINE;
 OBJC_INLINE void objc_array_destroy(objc_array array){
 	_array arr = (_array)array;
+	_array_storage storage;
 	if (arr == NULL){
 		return;
 	}
-	
-	_array_destroy_enumerator(arr->first);
-	objc_rw_lock_destroy(arr->_lock);
-	objc_dealloc(array);
+
+	storage = arr->storage;
+	while (storage != _array_initial_storage(arr)){
+		_array_storage previous = storage->previous;
+		objc_reclaim_retire(storage);
+		storage = previous;
+	}
+	objc_reclaim_retire(array);
 }
 
+OBJC_INLINE void objc_array_append(objc_array array, void *ptr) OBJC_ALWAYS_INLINE;
 OBJC_INLINE void objc_array_append(objc_array array, void *ptr){
 	_array arr = (_array)array;
-	objc_array_enumerator en;
-	if (arr == NULL){
+	if (arr == NULL || ptr == NULL){
 		return;
 	}
-	
-	en = objc_alloc(sizeof(struct _objc_array_enumerator));
-	en->item = ptr;
-	en->next = NULL;
-	
-	objc_rw_lock_wlock(arr->_lock);
-	if (arr->first == NULL){
-		arr->first = arr->last = en;
-	}else{
-		arr->last->next = en;
-		arr->last = en;
+
+	while (YES){
+		_array_storage storage = objc_atomic_load_acquire(&arr->storage);
+		unsigned int count = objc_atomic_load_acquire(&storage->count);
+
+		if (count == storage->capacity){
+			_array_grow(arr, storage);
+			continue;
+		}
+
+		if (objc_atomic_compare_and_swap(&_array_storage_items(storage)[count], NULL, ptr)){
+			(void)objc_atomic_compare_and_swap(&storage->count, count, count + 1);
+			return;
+		}
+
+		/* The slot has been taken - help publishing it and try the next one. */
+		(void)objc_atomic_compare_and_swap(&storage->count, count, count + 1);
 	}
-	objc_rw_lock_unlock(arr->_lock);
 }
 
-OBJC_INLINE objc_array_enumerator objc_array_get_enumerator(objc_array array){
-	return ((_array)array)->first;
+OBJC_INLINE void **objc_array_get_items(objc_array array, unsigned int *count) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void **objc_array_get_items(objc_array array, unsigned int *count){
+	_array_storage storage = objc_atomic_load_acquire(&((_array)array)->storage);
+	*count = objc_atomic_load_acquire(&storage->count);
+	return _array_storage_items(storage);
 }
 
 #endif /* ARRAY_INLINE_H_ */
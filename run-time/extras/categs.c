@@ -12,12 +12,13 @@ typedef struct {
 
 
 OBJC_INLINE BOOL _category_named_is_contained_in_list(const char *name, objc_array list){
-	objc_array_enumerator en = objc_array_get_enumerator(list);
-	while (en != NULL){
-		if (objc_strings_equal(name, ((Category)(en->item))->category_name)){
+	unsigned int count;
+	unsigned int i;
+	Category *categories = (Category*)objc_array_get_items(list, &count);
+	for (i = 0; i < count; ++i){
+		if (objc_strings_equal(name, categories[i]->category_name)){
 			return YES;
 		}
-		en = en->next;
 	}
 	return NO;
 }
@@ -61,40 +62,32 @@ Category objc_class_register_category_prototype(struct objc_category_prototype *
 
 OBJC_INLINE unsigned int _number_of_categories_in_class(Class cl){
 	categories_extension_class_part *ext_part = (categories_extension_class_part*)objc_class_extensions_beginning_for_extension(cl, &categories_extension);
-	objc_array_enumerator en;
 	unsigned int count = 0;
 	
 	if (ext_part->categories == NULL){
 		return 0;
 	}
 	
-	en = objc_array_get_enumerator(ext_part->categories);
-	while (en != NULL) {
-		++count;
-		en = en->next;
-	}
-	
+	objc_array_get_items(ext_part->categories, &count);
 	return count;
 }
 
 Category *objc_class_get_category_list(Class cl){
 	categories_extension_class_part *ext_part = (categories_extension_class_part*)objc_class_extensions_beginning_for_extension(cl, &categories_extension);
 	unsigned int number_of_categories = _number_of_categories_in_class(cl);
-	unsigned int space_left = number_of_categories;
 	Category *categories = objc_alloc((number_of_categories + 1) * sizeof(Category));
-	objc_array_enumerator en;
+	Category *all_categories;
+	unsigned int i;
 	
 	if (number_of_categories == 0){
 		categories[0] = NULL;
 		return categories;
 	}
 	
-	en = objc_array_get_enumerator(ext_part->categories);
-	while (en != NULL && space_left > 0) {
-		categories[number_of_categories - space_left] = en->item;
-		
-		--space_left;
-		en = en->next;
+	/* Categories added in the meanwhile are ignored. */
+	all_categories = (Category*)objc_array_get_items(ext_part->categories, &i);
+	for (i = 0; i < number_of_categories; ++i){
+		categories[i] = all_categories[i];
 	}
 	
 	categories[number_of_categories] = NULL;
@@ -114,25 +107,23 @@ const char *objc_category_get_name(Category category){
 
 
 OBJC_INLINE Method _find_method_in_list(objc_array list, SEL selector){
-	objc_array_enumerator en;
+	Method **lists;
+	unsigned int count;
+	unsigned int i;
 	
 	if (list == NULL){
 		return NULL;
 	}
 	
-	en = objc_array_get_enumerator(list);
-	while (en != NULL) {
-		Method *methods = en->item;
-		if (methods != NULL){
-			while (*methods != NULL) {
-				if (objc_selectors_equal(selector, (*methods)->selector)){
-					return *methods;
-				}
-				++methods;
+	lists = (Method**)objc_array_get_items(list, &count);
+	for (i = 0; i < count; ++i) {
+		Method *methods = lists[i];
+		while (*methods != NULL) {
+			if (objc_selectors_equal(selector, (*methods)->selector)){
+				return *methods;
 			}
+			++methods;
 		}
-		
-		en = en->next;
 	}
 	
 	return NULL;
@@ -140,55 +131,111 @@ OBJC_INLINE Method _find_method_in_list(objc_array list, SEL selector){
 
 static Method instance_lookup_function(Class cl, SEL selector){
 	categories_extension_class_part *ext_part = (categories_extension_class_part*)objc_class_extensions_beginning_for_extension(cl, &categories_extension);
-	objc_array_enumerator en;
+	Category *categories;
+	unsigned int count;
+	unsigned int i;
 	
 	if (ext_part->categories == NULL){
 		return NULL;
 	}
 	
-	en = objc_array_get_enumerator(ext_part->categories);
-	while (en != NULL){
-		Category c = en->item;
-		Method m = _find_method_in_list(c->instance_methods, selector);
+	categories = (Category*)objc_array_get_items(ext_part->categories, &count);
+	for (i = 0; i < count; ++i){
+		Method m = _find_method_in_list(categories[i]->instance_methods, selector);
 		if (m != NULL){
 			return m;
 		}
-		
-		en = en->next;
 	}
 	
 	return NULL;
 }
 static Method class_lookup_function(Class cl, SEL selector){
 	categories_extension_class_part *ext_part = (categories_extension_class_part*)objc_class_extensions_beginning_for_extension(cl, &categories_extension);
-	objc_array_enumerator en;
+	Category *categories;
+	unsigned int count;
+	unsigned int i;
 	
 	if (ext_part->categories == NULL){
 		return NULL;
 	}
 	
-	en = objc_array_get_enumerator(ext_part->categories);
-	while (en != NULL){
-		Category c = en->item;
-		Method m = _find_method_in_list(c->class_methods, selector);
+	categories = (Category*)objc_array_get_items(ext_part->categories, &count);
+	for (i = 0; i < count; ++i){
+		Method m = _find_method_in_list(categories[i]->class_methods, selector);
 		if (m != NULL){
 			return m;
 		}
-		
-		en = en->next;
 	}
 	
 	return NULL;
 }
 
+/**
+ * Returns the methods of all categories of cl, as returned by list_getter,
+ * in the order in which the lookup functions above search them.
+ */
+static Method *_methods_of_categories(Class cl, objc_array(*list_getter)(Category)){
+	categories_extension_class_part *ext_part = (categories_extension_class_part*)objc_class_extensions_beginning_for_extension(cl, &categories_extension);
+	Category *categories = NULL;
+	Method **lists;
+	Method *methods;
+	unsigned int category_count = 0;
+	unsigned int count = 0;
+	unsigned int i;
+	
+	if (ext_part->categories != NULL){
+		categories = (Category*)objc_array_get_items(ext_part->categories, &category_count);
+	}
+	
+	lists = objc_alloc((category_count + 1) * sizeof(Method*));
+	for (i = 0; i < category_count; ++i){
+		Method *m;
+		lists[i] = objc_method_list_flatten(list_getter(categories[i]));
+		for (m = lists[i]; *m != NULL; ++m){
+			++count;
+		}
+	}
+	
+	methods = objc_alloc((count + 1) * sizeof(Method));
+	count = 0;
+	for (i = 0; i < category_count; ++i){
+		Method *m;
+		for (m = lists[i]; *m != NULL; ++m){
+			methods[count++] = *m;
+		}
+		objc_dealloc(lists[i]);
+	}
+	methods[count] = NULL;
+	objc_dealloc(lists);
+	
+	return methods;
+}
+
+static objc_array _category_instance_methods(Category category){
+	return category->instance_methods;
+}
+static objc_array _category_class_methods(Category category){
+	return category->class_methods;
+}
+
+static Method *instance_methods_function(Class cl){
+	return _methods_of_categories(cl, _category_instance_methods);
+}
+static Method *class_methods_function(Class cl){
+	return _methods_of_categories(cl, _category_class_methods);
+}
+
 
 void objc_categories_register_extension(void){
 	categories_extension.class_initializer = NULL;
 	categories_extension.class_lookup_function = class_lookup_function;
+	categories_extension.class_methods_function = class_methods_function;
 	categories_extension.extra_class_space = sizeof(categories_extension);
 	categories_extension.extra_object_space = 0;
 	categories_extension.instance_lookup_function = instance_lookup_function;
+	categories_extension.instance_methods_function = instance_methods_function;
 	categories_extension.object_destructor = NULL;
+	categories_extension.object_has_managed_lifetime = NULL;
 	categories_extension.object_initializer = NULL; /* Lazy allocation */
 	
 	objc_class_add_extension(&categories_extension);
@@ -0,0 +1,125 @@
+
+#ifndef OBJC_CHUNKS_H_
+#define OBJC_CHUNKS_H_
+
+/*
+ * Chunk set - memory chunks allocated by a class extension, which tells
+ * whether an address lies within one of them without touching any memory
+ * at the address, so that it may be asked about any object.
+ *
+ * The chunks are kept sorted by address in an array, which is replaced
+ * as a whole when a chunk is added, so that lookups need no locking.
+ * The outgrown arrays are retired and lookups read the array within
+ * a reclamation section (see reclaim.h). Each chunk is at least a quarter
+ * of all the chunks allocated so far, hence there are only a few dozen
+ * chunks even for gigabytes of memory. Chunks are never returned
+ * to the system.
+ */
+
+#include "../os.h"
+#include "../atomic.h"
+#include "../reclaim.h"
+
+typedef struct {
+	char *start;
+	char *end;
+} objc_chunk;
+
+typedef struct {
+	unsigned int count;
+	objc_chunk chunks[];
+} objc_chunk_array;
+
+/* A zeroed structure is an empty set. */
+typedef struct {
+	objc_chunk_array *array;
+	unsigned long size; /* Of all the chunks */
+} objc_chunk_set;
+
+/**
+ * Allocates a new chunk of at least min_size bytes, aligned to alignment,
+ * which must be a power of two, and adds it to the set. The actual size,
+ * a multiple of alignment, is stored in size.
+ *
+ * The caller is responsible for not adding chunks to the same set
+ * from several threads at once.
+ */
+OBJC_INLINE char *objc_chunk_set_allocate(objc_chunk_set *set, unsigned long min_size, unsigned long alignment, unsigned long *size) OBJC_ALWAYS_INLINE;
+OBJC_INLINE char *objc_chunk_set_allocate(objc_chunk_set *set, unsigned long min_size, unsigned long alignment, unsigned long *size){
+	objc_chunk_array *array = set->array;
+	objc_chunk_array *new_array;
+	unsigned long chunk_size = min_size;
+	unsigned int count = (array == NULL) ? 0 : array->count;
+	unsigned int position;
+	unsigned int i;
+	char *raw;
+	char *start;
+
+	if (set->size / 4 > chunk_size){
+		chunk_size = set->size / 4;
+	}
+	chunk_size = (chunk_size + alignment - 1) & ~(alignment - 1);
+
+	raw = (char*)objc_alloc(chunk_size + alignment);
+	start = (char*)(((unsigned long)raw + alignment - 1) & ~(alignment - 1));
+
+	/* Keeps the chunks sorted by address. */
+	for (position = 0; position < count && array->chunks[position].start < start; ++position){
+	}
+
+	new_array = (objc_chunk_array*)objc_alloc(sizeof(objc_chunk_array) + (count + 1) * sizeof(objc_chunk));
+	for (i = 0; i < position; ++i){
+		new_array->chunks[i] = array->chunks[i];
+	}
+	new_array->chunks[position].start = start;
+	new_array->chunks[position].end = start + chunk_size;
+	for (i = position; i < count; ++i){
+		new_array->chunks[i + 1] = array->chunks[i];
+	}
+	new_array->count = count + 1;
+
+	objc_atomic_store_release(&set->array, new_array);
+	if (array != NULL){
+		objc_reclaim_retire(array);
+	}
+	set->size += chunk_size;
+
+	*size = chunk_size;
+	return start;
+}
+
+/**
+ * Returns YES if ptr lies within one of the chunks of set.
+ */
+OBJC_INLINE BOOL objc_chunk_set_contains(objc_chunk_set *set, void *ptr) OBJC_ALWAYS_INLINE;
+OBJC_INLINE BOOL objc_chunk_set_contains(objc_chunk_set *set, void *ptr){
+	objc_chunk_array *array;
+	unsigned int low = 0;
+	unsigned int high;
+	BOOL contains;
+
+	objc_reclaim_enter();
+	array = objc_atomic_load_acquire(&set->array);
+	if (array == NULL){
+		objc_reclaim_exit();
+		return NO;
+	}
+
+	/* Looks for the last chunk starting at or before ptr. */
+	high = array->count;
+	while (high - low > 1){
+		unsigned int middle = (low + high) / 2;
+		if (array->chunks[middle].start <= (char*)ptr){
+			low = middle;
+		}else{
+			high = middle;
+		}
+	}
+
+	contains = array->chunks[low].start <= (char*)ptr && (char*)ptr < array->chunks[low].end;
+	objc_reclaim_exit();
+
+	return contains;
+}
+
+#endif /* OBJC_CHUNKS_H_ */
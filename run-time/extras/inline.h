@@ -67,4 +67,14 @@ OBJC_INLINE void objc_rw_lock_wlock(objc_rw_lock lock){
 #include "array-inline.h"
 #include "holder-inline.h"
 
+/**
+ * Define OBJC_SPARSE_DISPATCH_TABLES to 1 to use the sparse
+ * dispatch tables instead of the default cache.
+ */
+#if OBJC_SPARSE_DISPATCH_TABLES
+	#include "sparse-inline.h"
+#else
+	#include "cache-inline.h"
+#endif
+
 #endif
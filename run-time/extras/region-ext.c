@@ -0,0 +1,283 @@
+/**
+ * Region class extension, see region-ext.h.
+ *
+ * A region is a list of pages, which are REGION_PAGE_SIZE bytes large
+ * and aligned to REGION_PAGE_SIZE, so that the page of an instance
+ * is found by masking its address. The pages are carved from chunks,
+ * which tell the instances apart from the objects allocated elsewhere.
+ * Each page starts with a header, the region structure itself is placed
+ * in the first page of the region.
+ *
+ * Each instance is preceded by a header with its size, so that the
+ * instances can be walked when the region is popped.
+ *
+ * Pages of popped regions are kept in a pool and reused.
+ */
+
+#include "region-ext.h"
+#include "../classext.h"
+#include "../class.h"
+#include "../atomic.h"
+#include "../utils.h"
+#include "chunks.h"
+
+objc_class_extension region_extension;
+
+#define REGION_PAGE_SIZE 4096
+#define REGION_GRANULARITY 16
+#define REGION_MAX_OBJECT_SIZE 1024
+
+/**
+ * Pages are allocated in chunks of at least this many pages.
+ */
+#define REGION_CHUNK_PAGE_COUNT 64
+
+#define REGION_MAGIC ((unsigned long)0x4E6104E6UL)
+
+#define REGION_ROUND_UP(SIZE) (((SIZE) + REGION_GRANULARITY - 1) & ~(unsigned long)(REGION_GRANULARITY - 1))
+
+/**
+ * Header of a page. Pages in the pool have no magic, so that instances
+ * of popped regions aren't considered to be in a region.
+ *
+ * next - next page of the region (the pages are in the reverse
+ *	order of allocation), or the next page in the pool.
+ * objects, objects_end - the instances in the page.
+ */
+typedef struct _region_page_str {
+	unsigned long magic;
+	struct _region_page_str *next;
+	char *objects;
+	char *objects_end;
+} _region_page;
+
+#define REGION_PAGE_HEADER_SIZE REGION_ROUND_UP(sizeof(_region_page))
+
+typedef struct _region_str {
+	struct _region_str *previous;
+	_region_page *pages;
+	char *next_object;
+	char *page_end;
+} _region;
+
+typedef struct {
+	unsigned int size; /* Including the header */
+	BOOL deallocated;
+} _region_object_header;
+
+#define REGION_OBJECT_HEADER_SIZE REGION_ROUND_UP(sizeof(_region_object_header))
+
+static BOOL region_extension_registered = NO;
+static OBJC_THREAD_LOCAL _region *current_region;
+
+/**
+ * All the memory of pages, and pages that are not used by any region.
+ */
+static objc_chunk_set region_chunks;
+static int region_pool_lock;
+static _region_page *region_free_pages;
+static char *region_pool;
+static unsigned int region_pool_count;
+
+OBJC_INLINE void _region_pool_lock(void) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _region_pool_lock(void){
+	while (!objc_atomic_compare_and_swap(&region_pool_lock, 0, 1)){
+		while (objc_atomic_load_relaxed(&region_pool_lock) != 0){
+			/* Spin */
+		}
+	}
+}
+
+OBJC_INLINE void _region_pool_unlock(void) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _region_pool_unlock(void){
+	objc_atomic_store_release(&region_pool_lock, 0);
+}
+
+OBJC_INLINE _region_page *_region_page_of_object(void *obj) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _region_page *_region_page_of_object(void *obj){
+	return (_region_page*)((unsigned long)obj & ~(unsigned long)(REGION_PAGE_SIZE - 1));
+}
+
+/**
+ * The page header may only be read once the address is known
+ * to lie within the region chunks.
+ */
+OBJC_INLINE BOOL _region_object_is_in_region(void *obj) OBJC_ALWAYS_INLINE;
+OBJC_INLINE BOOL _region_object_is_in_region(void *obj){
+	return objc_chunk_set_contains(&region_chunks, obj) && _region_page_of_object(obj)->magic == REGION_MAGIC;
+}
+
+static _region_page *_region_page_create(void){
+	_region_page *page;
+	
+	_region_pool_lock();
+	if (region_free_pages != NULL){
+		page = region_free_pages;
+		region_free_pages = page->next;
+	}else{
+		if (region_pool_count == 0){
+			unsigned long size;
+			region_pool = objc_chunk_set_allocate(&region_chunks, REGION_CHUNK_PAGE_COUNT * REGION_PAGE_SIZE, REGION_PAGE_SIZE, &size);
+			region_pool_count = (unsigned int)(size / REGION_PAGE_SIZE);
+		}
+		page = (_region_page*)region_pool;
+		region_pool += REGION_PAGE_SIZE;
+		--region_pool_count;
+	}
+	_region_pool_unlock();
+	
+	page->magic = REGION_MAGIC;
+	page->next = NULL;
+	page->objects = (char*)page + REGION_PAGE_HEADER_SIZE;
+	page->objects_end = page->objects;
+	return page;
+}
+
+/**
+ * Continues the region in a new page.
+ */
+static void _region_add_page(_region *region){
+	_region_page *page = _region_page_create();
+	
+	region->pages->objects_end = region->next_object;
+	page->next = region->pages;
+	region->pages = page;
+	region->next_object = page->objects;
+	region->page_end = (char*)page + REGION_PAGE_SIZE;
+}
+
+static void *_region_allocate(unsigned long size){
+	_region *region = current_region;
+	_region_object_header *header;
+	objc_memory_word *obj;
+	unsigned long i;
+	
+	if (region == NULL){
+		return objc_zero_alloc(size);
+	}
+	
+	size = REGION_ROUND_UP(size);
+	if ((unsigned long)(region->page_end - region->next_object) < REGION_OBJECT_HEADER_SIZE + size){
+		_region_add_page(region);
+	}
+	
+	header = (_region_object_header*)region->next_object;
+	header->size = (unsigned int)(REGION_OBJECT_HEADER_SIZE + size);
+	header->deallocated = NO;
+	region->next_object += header->size;
+	
+	/* The pages are reused, hence the memory needs to be zeroed. */
+	obj = (objc_memory_word*)((char*)header + REGION_OBJECT_HEADER_SIZE);
+	for (i = 0; i < size / sizeof(objc_memory_word); ++i){
+		obj[i] = 0;
+	}
+	return obj;
+}
+
+/**
+ * The instance has already been finalized by objc_object_deallocate,
+ * it just mustn't be finalized again when the region is popped.
+ */
+static void _region_deallocate(void *obj){
+	((_region_object_header*)((char*)obj - REGION_OBJECT_HEADER_SIZE))->deallocated = YES;
+}
+
+static objc_allocator_f _region_allocator_for_class(Class cl, unsigned int size){
+	if (size == 0 || size > REGION_MAX_OBJECT_SIZE){
+		return NULL;
+	}
+	return _region_allocate;
+}
+
+/**
+ * Just like in the slab extension, the address is looked up in the chunks.
+ */
+static objc_deallocator_f _region_deallocator_for_object(id obj, unsigned int size){
+	if (!_region_object_is_in_region(obj)){
+		return NULL;
+	}
+	return _region_deallocate;
+}
+
+void objc_region_push(void){
+	_region_page *page;
+	_region *region;
+	
+	if (!region_extension_registered){
+		objc_abort("The region extension hasn't been registered.");
+	}
+	
+	page = _region_page_create();
+	region = (_region*)page->objects;
+	page->objects += REGION_ROUND_UP(sizeof(_region));
+	page->objects_end = page->objects;
+	
+	region->previous = current_region;
+	region->pages = page;
+	region->next_object = page->objects;
+	region->page_end = (char*)page + REGION_PAGE_SIZE;
+	
+	current_region = region;
+}
+
+void objc_region_pop(void){
+	_region *region = current_region;
+	_region_page *newest_page;
+	_region_page *oldest_page;
+	_region_page *page;
+	
+	if (region == NULL){
+		objc_abort("Popping a region, but no region is active.");
+	}
+	
+	/* Objects created by the destructors don't belong to the region. */
+	current_region = region->previous;
+	
+	region->pages->objects_end = region->next_object;
+	newest_page = region->pages;
+	for (page = newest_page; page != NULL; page = page->next){
+		char *ptr = page->objects;
+		while (ptr < page->objects_end){
+			_region_object_header *header = (_region_object_header*)ptr;
+			if (!header->deallocated){
+				objc_finalize_object((id)(ptr + REGION_OBJECT_HEADER_SIZE));
+			}
+			ptr += header->size;
+		}
+	}
+	
+	/* The region structure lives in the oldest page, don't touch it afterwards. */
+	oldest_page = newest_page;
+	for (page = newest_page; page != NULL; page = page->next){
+		page->magic = 0;
+		oldest_page = page;
+	}
+	
+	_region_pool_lock();
+	oldest_page->next = region_free_pages;
+	region_free_pages = newest_page;
+	_region_pool_unlock();
+}
+
+BOOL objc_region_contains_object(id obj){
+	if (!region_extension_registered || obj == nil){
+		return NO;
+	}
+	return _region_object_is_in_region(obj);
+}
+
+void objc_region_register_extension(void){
+	region_extension.object_allocator_for_class = _region_allocator_for_class;
+	region_extension.object_deallocator_for_object = _region_deallocator_for_object;
+	region_extension.class_initializer = NULL;
+	region_extension.class_lookup_function = NULL;
+	region_extension.extra_class_space = 0;
+	region_extension.extra_object_space = 0;
+	region_extension.instance_lookup_function = NULL;
+	region_extension.object_destructor = NULL;
+	region_extension.object_has_managed_lifetime = objc_region_contains_object;
+	region_extension.object_initializer = NULL;
+	
+	objc_class_add_extension(&region_extension);
+	region_extension_registered = YES;
+}
@@ -0,0 +1,41 @@
+#ifndef REGION_ALLOCATOR_H_
+#define REGION_ALLOCATOR_H_
+
+#include "../os.h"
+
+/**
+ * Registers the region extension with the run-time.
+ *
+ * While a region is active on a thread, instances of up to 1024 bytes
+ * (including the extra space of class extensions) created by the thread
+ * are bump-allocated from the region. Outside of regions, the default
+ * allocator is used. As the region allocator is chosen for all such
+ * classes, it takes precedence over allocators of extensions
+ * registered before it.
+ */
+extern void objc_region_register_extension(void);
+
+/**
+ * Starts a new region on the current thread. Regions nest - the region
+ * that has been active so far becomes active again once the new one
+ * is popped.
+ */
+extern void objc_region_push(void);
+
+/**
+ * Ends the innermost region of the current thread. The object destructors
+ * of class extensions are called on all instances in the region that
+ * haven't been deallocated yet and the memory of the whole region is
+ * released at once. The instances must not be used afterwards.
+ *
+ * Deallocating an instance that lives in a region only finalizes it,
+ * the memory is released along with the region.
+ */
+extern void objc_region_pop(void);
+
+/**
+ * Returns YES if obj has been allocated in a region.
+ */
+extern BOOL objc_region_contains_object(id obj);
+
+#endif /* REGION_ALLOCATOR_H_ */
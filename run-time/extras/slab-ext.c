@@ -0,0 +1,222 @@
+/**
+ * Slab allocator class extension, see slab-ext.h.
+ *
+ * Slabs are SLAB_SIZE bytes large and aligned to SLAB_SIZE, so that
+ * the slab of an instance is found by masking its address. Each slab
+ * starts with a header, followed by instances of a single size class.
+ * The slabs are carved from chunks, which tell the instances apart
+ * from the objects allocated elsewhere.
+ *
+ * Each size class keeps a free list of instances returned by threads
+ * and the rest of the slab that is being carved. Both are guarded by
+ * a spin lock, which is only taken to move half a magazine at once.
+ */
+
+#include "slab-ext.h"
+#include "../classext.h"
+#include "../atomic.h"
+#include "../utils.h"
+#include "chunks.h"
+
+objc_class_extension slab_extension;
+
+#define SLAB_SIZE 4096
+
+/**
+ * Instance sizes are rounded up to a multiple of SLAB_GRANULARITY,
+ * larger instances than SLAB_MAX_OBJECT_SIZE are left to the default
+ * allocator.
+ */
+#define SLAB_GRANULARITY 16
+#define SLAB_MAX_OBJECT_SIZE 512
+#define SLAB_CLASS_COUNT (SLAB_MAX_OBJECT_SIZE / SLAB_GRANULARITY)
+
+/**
+ * Number of free instances a thread may keep per size class. When the
+ * magazine gets empty (full), half of it is refilled (returned).
+ */
+#define SLAB_MAGAZINE_SIZE 32
+
+/**
+ * Slabs are allocated in chunks of at least this many slabs.
+ */
+#define SLAB_CHUNK_SLAB_COUNT 64
+
+typedef struct {
+	int lock;
+	unsigned int object_size;
+	void *free_list; /* Linked through the first word of the instances */
+	char *next_object;
+	char *slab_end;
+} _slab_class;
+
+/**
+ * Header of a slab.
+ */
+typedef struct {
+	_slab_class *owner;
+} _slab_header;
+
+#define SLAB_HEADER_SIZE ((sizeof(_slab_header) + SLAB_GRANULARITY - 1) & ~(SLAB_GRANULARITY - 1))
+
+typedef struct {
+	unsigned int count;
+	void *objects[SLAB_MAGAZINE_SIZE];
+} _slab_magazine;
+
+static _slab_class slab_classes[SLAB_CLASS_COUNT];
+static OBJC_THREAD_LOCAL _slab_magazine slab_magazines[SLAB_CLASS_COUNT];
+
+/**
+ * All the memory of slabs, and slabs that haven't been
+ * given to any size class yet.
+ */
+static objc_chunk_set slab_chunks;
+static int slab_pool_lock;
+static char *slab_pool;
+static unsigned int slab_pool_count;
+
+OBJC_INLINE void _slab_lock(int *lock) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _slab_lock(int *lock){
+	while (!objc_atomic_compare_and_swap(lock, 0, 1)){
+		while (objc_atomic_load_relaxed(lock) != 0){
+			/* Spin */
+		}
+	}
+}
+
+OBJC_INLINE void _slab_unlock(int *lock) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _slab_unlock(int *lock){
+	objc_atomic_store_release(lock, 0);
+}
+
+OBJC_INLINE _slab_header *_slab_header_of_object(void *obj) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _slab_header *_slab_header_of_object(void *obj){
+	return (_slab_header*)((unsigned long)obj & ~(unsigned long)(SLAB_SIZE - 1));
+}
+
+/**
+ * Starts carving a new slab. Must be called with the lock of cl held.
+ */
+static void _slab_create(_slab_class *cl){
+	_slab_header *header;
+
+	_slab_lock(&slab_pool_lock);
+	if (slab_pool_count == 0){
+		unsigned long size;
+		slab_pool = objc_chunk_set_allocate(&slab_chunks, SLAB_CHUNK_SLAB_COUNT * SLAB_SIZE, SLAB_SIZE, &size);
+		slab_pool_count = (unsigned int)(size / SLAB_SIZE);
+	}
+	header = (_slab_header*)slab_pool;
+	slab_pool += SLAB_SIZE;
+	--slab_pool_count;
+	_slab_unlock(&slab_pool_lock);
+
+	header->owner = cl;
+
+	cl->next_object = (char*)header + SLAB_HEADER_SIZE;
+	cl->slab_end = (char*)header + SLAB_SIZE;
+}
+
+/**
+ * Fills half of the magazine from the free list of cl,
+ * or, if it's empty, from the slab being carved.
+ */
+static void _slab_refill_magazine(_slab_class *cl, _slab_magazine *magazine){
+	_slab_lock(&cl->lock);
+	while (magazine->count < SLAB_MAGAZINE_SIZE / 2){
+		if (cl->free_list != NULL){
+			void *obj = cl->free_list;
+			cl->free_list = *(void**)obj;
+			magazine->objects[magazine->count++] = obj;
+			continue;
+		}
+
+		if ((unsigned long)(cl->slab_end - cl->next_object) < cl->object_size){
+			_slab_create(cl);
+		}
+		magazine->objects[magazine->count++] = cl->next_object;
+		cl->next_object += cl->object_size;
+	}
+	_slab_unlock(&cl->lock);
+}
+
+/**
+ * Returns half of the magazine to the free list of cl.
+ */
+static void _slab_flush_magazine(_slab_class *cl, _slab_magazine *magazine){
+	_slab_lock(&cl->lock);
+	while (magazine->count > SLAB_MAGAZINE_SIZE / 2){
+		void *obj = magazine->objects[--magazine->count];
+		*(void**)obj = cl->free_list;
+		cl->free_list = obj;
+	}
+	_slab_unlock(&cl->lock);
+}
+
+static void *_slab_allocate(unsigned long size){
+	unsigned int index = (unsigned int)((size + SLAB_GRANULARITY - 1) / SLAB_GRANULARITY) - 1;
+	_slab_magazine *magazine = &slab_magazines[index];
+	objc_memory_word *obj;
+	unsigned int i;
+
+	if (magazine->count == 0){
+		_slab_refill_magazine(&slab_classes[index], magazine);
+	}
+
+	/* Instances are aligned and their size is a multiple of the granularity. */
+	obj = (objc_memory_word*)magazine->objects[--magazine->count];
+	for (i = 0; i < slab_classes[index].object_size / sizeof(objc_memory_word); ++i){
+		obj[i] = 0;
+	}
+	return obj;
+}
+
+static void _slab_deallocate(void *obj){
+	_slab_class *cl = _slab_header_of_object(obj)->owner;
+	_slab_magazine *magazine = &slab_magazines[cl - slab_classes];
+
+	if (magazine->count == SLAB_MAGAZINE_SIZE){
+		_slab_flush_magazine(cl, magazine);
+	}
+	magazine->objects[magazine->count++] = obj;
+}
+
+static objc_allocator_f _slab_allocator_for_class(Class cl, unsigned int size){
+	if (size == 0 || size > SLAB_MAX_OBJECT_SIZE){
+		return NULL;
+	}
+	return _slab_allocate;
+}
+
+/**
+ * The size is just a hint (the class of the object may have changed),
+ * hence the address is looked up in the slab chunks instead.
+ */
+static objc_deallocator_f _slab_deallocator_for_object(id obj, unsigned int size){
+	if (!objc_chunk_set_contains(&slab_chunks, obj)){
+		return NULL;
+	}
+	return _slab_deallocate;
+}
+
+void objc_slab_allocator_register_extension(void){
+	unsigned int i;
+
+	for (i = 0; i < SLAB_CLASS_COUNT; ++i){
+		slab_classes[i].object_size = (i + 1) * SLAB_GRANULARITY;
+	}
+
+	slab_extension.object_allocator_for_class = _slab_allocator_for_class;
+	slab_extension.object_deallocator_for_object = _slab_deallocator_for_object;
+	slab_extension.class_initializer = NULL;
+	slab_extension.class_lookup_function = NULL;
+	slab_extension.extra_class_space = 0;
+	slab_extension.extra_object_space = 0;
+	slab_extension.instance_lookup_function = NULL;
+	slab_extension.object_destructor = NULL;
+	slab_extension.object_has_managed_lifetime = NULL;
+	slab_extension.object_initializer = NULL;
+
+	objc_class_add_extension(&slab_extension);
+}
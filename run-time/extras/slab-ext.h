@@ -0,0 +1,20 @@
+#ifndef SLAB_ALLOCATOR_H_
+#define SLAB_ALLOCATOR_H_
+
+#include "../os.h"
+
+/**
+ * Registers the slab allocator extension with the run-time.
+ *
+ * Instances of up to 512 bytes (including the extra space of class
+ * extensions) are then carved from page-sized slabs, one set of slabs
+ * per size rounded up to 16 bytes. Each thread keeps a magazine of free
+ * instances of each size, so that allocating and deallocating an
+ * instance mostly doesn't need any synchronization at all.
+ *
+ * The slabs are never returned to the system. Instances cached in the
+ * magazine of a thread that exits are not reused.
+ */
+extern void objc_slab_allocator_register_extension(void);
+
+#endif /* SLAB_ALLOCATOR_H_ */
@@ -95,16 +95,35 @@ typedef Class(*objc_class_holder_lookup_f)(objc_class_holder, const char*);
 typedef objc_selector_holder(*objc_selector_holder_creator_f)(void);
 
 /**
- * Adds the selector to the data structure. The selector holder should be
- * a lockable structure, allowing access from multiple threads. The structure
- * should use the locks provided by the run-time so that in case the locks
- * are set to no-op in single-threaded environment, no locking is indeed 
- * performed.
+ * Adds the selector to the data structure, unless a selector with the same
+ * name is already there. Returns the selector held under the name afterwards,
+ * i.e. either the one passed in, or the one that had been inserted before.
+ * The check and the insert must be atomic - the run-time relies on there
+ * being a single SEL per name and compares selectors by pointer.
+ *
+ * The selector holder should be a lockable structure, allowing access
+ * from multiple threads. The structure should use the locks provided by
+ * the run-time so that in case the locks are set to no-op in single-threaded
+ * environment, no locking is indeed performed.
  *
  * To speed things up, a rw lock should be used. If the structure used
  * is a lock-free structure, you can ignore any locking.
  */
-typedef void(*objc_selector_holder_inserter_f)(objc_selector_holder, SEL);
+typedef SEL(*objc_selector_holder_inserter_f)(objc_selector_holder, SEL);
+
+/**
+ * Inserts count selectors as if the inserter was called for each of them,
+ * and replaces each selector in the array with the one the inserter would
+ * have returned. Allows the structure to lock just once for many selectors.
+ *
+ * The second and third arrays contain the hashes and lengths of the names,
+ * as returned by objc_hash_string_with_length, so that the structure doesn't
+ * need to hash the names again. It may ignore them.
+ *
+ * Optional - if not set for a custom selector holder, the run-time calls
+ * the inserter for each selector.
+ */
+typedef void(*objc_selector_holder_bulk_inserter_f)(objc_selector_holder, SEL*, const unsigned int*, const unsigned int*, unsigned int);
 
 /**
  * Find a selector in the objc_selector_holder according to the class name. Return
@@ -112,6 +131,15 @@ typedef void(*objc_selector_holder_inserter_f)(objc_selector_holder, SEL);
  */
 typedef SEL(*objc_selector_holder_lookup_f)(objc_selector_holder, const char*);
 
+/**
+ * Same as the lookup, but the hash and the length of the name, as returned
+ * by objc_hash_string_with_length, are passed along.
+ *
+ * Optional - if not set for a custom selector holder, the run-time calls
+ * the lookup.
+ */
+typedef SEL(*objc_selector_holder_hashed_lookup_f)(objc_selector_holder, const char*, unsigned int, unsigned int);
+
 
 /*********** objc_cache ***********/
 
@@ -123,24 +151,55 @@ typedef SEL(*objc_selector_holder_lookup_f)(objc_selector_holder, const char*);
  * operation locks the data structure in the default
  * implementation.
  *
+ * The Method is inserted under an explicit selector, which
+ * doesn't need to be the same as the selector of the Method
+ * (the run-time caches forwarded methods this way).
+ *
+ * Besides the Method, the cache is asked for the IMP
+ * directly by the dispatch functions. A cache should
+ * hence keep the IMP next to the selector so that
+ * a cache hit doesn't need to dereference the Method.
+ * As the cached IMP may become stale when a method
+ * implementation gets replaced, the run-time flushes
+ * the affected caches in such a case.
+ *
  * The destroying is a little tricky. The cache can be 
  * read from multiple threads at once, hence it cannot
  * be deallocated at that very moment.
  *
- * The default
- * implementation solves this by simply marking the structure
- * as 'to be deallocated'. At the beginning of each read from
- * the cache, reader count is increased, at the end decreased.
+ * The cache should also be able to fill in objc_cache_statistics
+ * so that the cache behavior can be examined at run-time. The
+ * probe lengths can be reported as 1 by implementations that
+ * don't probe.
  *
- * Once the reader count is zero and the structure is marked
- * as to be deallocated, it is actually deallocated. This can be
- * done simply because the cache structure is marked to be
- * deleted *after* a new one has been created and placed instead.
+ * The run-time unlinks the cache from the class before
+ * destroying it and only reads caches within reclamation
+ * sections (see reclaim.h). The cache should hence pass its
+ * memory to objc_reclaim_retire rather than deallocating it.
+ * An insert may still arrive after the cache has been
+ * destroyed, it should be ignored. The same goes for a table
+ * that has been replaced by a larger one.
  */
 typedef objc_cache(*objc_cache_creator_f)(void);
 typedef void(*objc_cache_mark_to_dealloc_f)(objc_cache);
-typedef void(*objc_cache_inserter_f)(objc_cache, Method);
+typedef void(*objc_cache_inserter_f)(objc_cache, SEL, Method);
 typedef Method(*objc_cache_fetcher_f)(objc_cache, SEL);
+typedef IMP(*objc_cache_imp_fetcher_f)(objc_cache, SEL);
+typedef void(*objc_cache_statistics_getter_f)(objc_cache, objc_cache_statistics*);
+
+/**
+ * Optionally, a cache of a class may be derived from the cache of its
+ * superclass, taking over its entries except for those whose selector
+ * the class implements itself, as told by the overrides function
+ * (called with the context passed to the deriver). The new cache
+ * mustn't depend on the superclass' cache, which may be destroyed
+ * right afterwards. The class caches only hold methods inserted
+ * under their own selectors, hence method->selector is the selector
+ * of an entry. A cache that can't share its contents may just
+ * create an empty cache.
+ */
+typedef BOOL(*objc_cache_overrides_f)(void*, SEL);
+typedef objc_cache(*objc_cache_deriver_f)(objc_cache, objc_cache_overrides_f, void*);
 
 
 /*********** Synchronization ***********/
@@ -194,16 +253,18 @@ typedef int(*objc_rw_lock_unlock_f)(objc_rw_lock);
 typedef objc_array(*objc_array_creator_f)(void);
 
 /**
- * Returns an enumerator.
+ * Returns the items of the array as a C-array and stores the number
+ * of items into *count. The items must stay readable at that address
+ * even if other threads append items in the meanwhile - items appended
+ * after the call simply aren't included in *count.
  */
-typedef objc_array_enumerator(*objc_array_enumerator_getter_f)(objc_array);
+typedef void**(*objc_array_items_getter_f)(objc_array, unsigned int*);
 
 /**
- * Adds an item at the end of the array.
+ * Adds an item at the end of the array. The item is never NULL.
  *
  * Note that it is necessary that the item
- * is really appended and not prepended,
- * unless you return a backward enumerator.
+ * is really appended and not prepended.
  */
 typedef void(*objc_array_append_f)(objc_array, void*);
 
@@ -0,0 +1,218 @@
+/*
+ * Interned strings, see intern.h.
+ *
+ * The strings are kept in an open-addressed hash table with linear
+ * probing, each slot holding the hash and the length next to the
+ * string. The table doubles each time it gets over 3/4 full.
+ *
+ * The characters are copied into chunks of INTERN_CHUNK_SIZE bytes.
+ * A string that wouldn't leave enough space in the chunk for others
+ * (i.e. longer than INTERN_LARGE_STRING_LENGTH) gets an allocation
+ * of its own. Neither is ever deallocated.
+ *
+ * Strings get interned mostly when classes and methods are being
+ * registered, not while messages are being sent, so a single lock
+ * is used to guard the table.
+ */
+
+#include "intern.h"
+#include "os.h"
+#include "utils.h"
+#include "private.h"
+
+/**
+ * Size of a chunk of the arena.
+ */
+#define INTERN_CHUNK_SIZE (16 * 1024)
+
+/**
+ * Strings longer than this are not allocated in the arena.
+ */
+#define INTERN_LARGE_STRING_LENGTH (INTERN_CHUNK_SIZE / 16)
+
+/**
+ * Number of slots of the initial table. Must be a power of two.
+ */
+#define INTERN_INITIAL_SLOT_COUNT 256
+
+#define INTERN_IS_OVER_LOAD_FACTOR(count, slot_count) ((count) * 4 > (slot_count) * 3)
+
+/**
+ * A slot of the table. A slot with NULL string is empty.
+ */
+typedef struct {
+	unsigned int hash;
+	unsigned int length;
+	const char *string;
+} _intern_entry;
+
+/**
+ * The table.
+ *
+ * entries - (mask + 1) slots.
+ * mask - number of slots - 1.
+ * count - number of filled slots.
+ */
+static _intern_entry *intern_entries;
+static unsigned int intern_mask;
+static unsigned int intern_count;
+
+/**
+ * The current chunk of the arena and the number of bytes left in it.
+ */
+static char *intern_chunk;
+static unsigned int intern_chunk_space_left;
+
+/**
+ * Guards all of the above.
+ */
+static objc_rw_lock intern_lock;
+
+
+/**
+ * Returns the slot of the string, or the empty slot where the
+ * string belongs if it hasn't been interned yet.
+ */
+OBJC_INLINE _intern_entry *_intern_entry_for_string(const char *str, unsigned int length, unsigned int hash) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _intern_entry *_intern_entry_for_string(const char *str, unsigned int length, unsigned int hash){
+	unsigned int index = hash & intern_mask;
+
+	while (intern_entries[index].string != NULL){
+		_intern_entry *entry = &intern_entries[index];
+		if (entry->hash == hash && entry->length == length){
+			unsigned int i = 0;
+			while (i < length && entry->string[i] == str[i]){
+				++i;
+			}
+			if (i == length){
+				return entry;
+			}
+		}
+		index = (index + 1) & intern_mask;
+	}
+	return &intern_entries[index];
+}
+
+/**
+ * Doubles the table. Must be called with the lock held.
+ */
+OBJC_INLINE void _intern_grow(void) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _intern_grow(void){
+	_intern_entry *old_entries = intern_entries;
+	unsigned int old_mask = intern_mask;
+	unsigned int index;
+
+	intern_mask = (old_mask + 1) * 2 - 1;
+	intern_entries = (_intern_entry*)objc_zero_alloc((intern_mask + 1) * sizeof(_intern_entry));
+
+	for (index = 0; index <= old_mask; ++index){
+		if (old_entries[index].string != NULL){
+			unsigned int new_index = old_entries[index].hash & intern_mask;
+			while (intern_entries[new_index].string != NULL){
+				new_index = (new_index + 1) & intern_mask;
+			}
+			intern_entries[new_index] = old_entries[index];
+		}
+	}
+
+	objc_dealloc(old_entries);
+}
+
+/**
+ * Copies length characters of str into the arena and NULL-terminates
+ * the copy. Must be called with the lock held.
+ */
+OBJC_INLINE char *_intern_copy_string(const char *str, unsigned int length) OBJC_ALWAYS_INLINE;
+OBJC_INLINE char *_intern_copy_string(const char *str, unsigned int length){
+	char *copy;
+	unsigned int i;
+
+	if (length > INTERN_LARGE_STRING_LENGTH){
+		copy = (char*)objc_alloc(length + 1);
+	}else{
+		if (intern_chunk_space_left < length + 1){
+			/* The rest of the current chunk is left unused. */
+			intern_chunk = (char*)objc_alloc(INTERN_CHUNK_SIZE);
+			intern_chunk_space_left = INTERN_CHUNK_SIZE;
+		}
+
+		copy = intern_chunk;
+		intern_chunk += length + 1;
+		intern_chunk_space_left -= length + 1;
+	}
+
+	for (i = 0; i < length; ++i){
+		copy[i] = str[i];
+	}
+	copy[length] = '\0';
+	return copy;
+}
+
+/**
+ * Interns a string whose hash and length are known.
+ */
+OBJC_INLINE const char *_intern_string(const char *str, unsigned int length, unsigned int hash) OBJC_ALWAYS_INLINE;
+OBJC_INLINE const char *_intern_string(const char *str, unsigned int length, unsigned int hash){
+	_intern_entry *entry;
+	const char *result;
+
+	if (!objc_runtime_has_been_initialized){
+		objc_runtime_init();
+	}
+
+	objc_rw_lock_rlock(intern_lock);
+	result = _intern_entry_for_string(str, length, hash)->string;
+	objc_rw_lock_unlock(intern_lock);
+
+	if (result != NULL){
+		return result;
+	}
+
+	objc_rw_lock_wlock(intern_lock);
+
+	/* Someone might have interned it in the meanwhile */
+	entry = _intern_entry_for_string(str, length, hash);
+	if (entry->string == NULL){
+		if (INTERN_IS_OVER_LOAD_FACTOR(intern_count + 1, intern_mask + 1)){
+			_intern_grow();
+			entry = _intern_entry_for_string(str, length, hash);
+		}
+
+		entry->hash = hash;
+		entry->length = length;
+		entry->string = _intern_copy_string(str, length);
+		++intern_count;
+	}
+	result = entry->string;
+
+	objc_rw_lock_unlock(intern_lock);
+	return result;
+}
+
+/* Public functions, documented in the header file. */
+
+const char *objc_string_intern(const char *str){
+	unsigned int length;
+	unsigned int hash;
+
+	if (str == NULL){
+		return NULL;
+	}
+
+	hash = objc_hash_string_with_length(str, &length);
+	return _intern_string(str, length, hash);
+}
+
+const char *objc_string_intern_with_hash(const char *str, unsigned int length, unsigned int hash){
+	if (str == NULL){
+		return NULL;
+	}
+
+	return _intern_string(str, length, hash);
+}
+
+void objc_string_intern_init(void){
+	intern_lock = objc_rw_lock_create();
+	intern_mask = INTERN_INITIAL_SLOT_COUNT - 1;
+	intern_entries = (_intern_entry*)objc_zero_alloc(INTERN_INITIAL_SLOT_COUNT * sizeof(_intern_entry));
+}
@@ -0,0 +1,30 @@
+/*
+ * Interned strings.
+ *
+ * Names of classes, selectors and ivars, as well as type encodings,
+ * are kept by the run-time for the whole life of the program. Instead
+ * of copying each of them into a separate allocation, they are copied
+ * into large chunks of memory (an arena) and identical strings are stored
+ * just once - e.g. "v@:" is shared by all the methods with such a type.
+ *
+ * Interned strings are never deallocated and must never be modified.
+ */
+
+#ifndef OBJC_INTERN_H_
+#define OBJC_INTERN_H_
+
+#include "types.h"
+
+/**
+ * Returns the interned copy of str. Returns NULL if str is NULL.
+ */
+extern const char *objc_string_intern(const char *str);
+
+/**
+ * The same as objc_string_intern, for callers that have already hashed
+ * str using objc_hash_string_with_length (e.g. to look it up in a holder),
+ * so that it isn't hashed again.
+ */
+extern const char *objc_string_intern_with_hash(const char *str, unsigned int length, unsigned int hash);
+
+#endif /* OBJC_INTERN_H_ */
@@ -1,7 +1,7 @@
 #include "method.h"
-#include "selector.h" /* For objc_selector_register. */
+#include "selector.h" /* For objc_selector_register_many. */
 #include "os.h" /* For objc_alloc. */
-#include "utils.h" /* For objc_strcpy */
+#include "intern.h" /* For objc_string_intern */
 
 #pragma mark -
 #pragma mark Private functions
@@ -12,20 +12,21 @@
 OBJC_INLINE unsigned int _method_count_in_method_list(objc_array list) OBJC_ALWAYS_INLINE;
 OBJC_INLINE unsigned int _method_count_in_method_list(objc_array list){
 	unsigned int count = 0;
-	objc_array_enumerator en;
+	unsigned int list_count;
+	unsigned int i;
+	Method **lists;
 	
 	if (list == NULL){
 		return count;
 	}
 	
-	en = objc_array_get_enumerator(list);
-	while (en != NULL) {
-		Method *methods = en->item;
+	lists = (Method**)objc_array_get_items(list, &list_count);
+	for (i = 0; i < list_count; ++i){
+		Method *methods = lists[i];
 		while (*methods != NULL){
 			++count;
 			++methods;
 		}
-		en = en->next;
 	}
 	return count;
 }
@@ -37,7 +38,9 @@ OBJC_INLINE unsigned int _method_count_in_method_list(objc_array list){
 OBJC_INLINE void _methods_copy_to_list(objc_array method_list, Method *list, unsigned int max_count) OBJC_ALWAYS_INLINE;
 OBJC_INLINE void _methods_copy_to_list(objc_array method_list, Method *list, unsigned int max_count){
 	unsigned int count = 0;
-	objc_array_enumerator en;
+	unsigned int list_count;
+	unsigned int i;
+	Method **lists;
 	
 	if (method_list == NULL){
 		/* NULL-terminate, even when NULL */
@@ -45,15 +48,14 @@ OBJC_INLINE void _methods_copy_to_list(objc_array method_list, Method *list, uns
 		return;
 	}
 	
-	en = objc_array_get_enumerator(method_list);
-	while (en != NULL) {
-		Method *methods = en->item;
-		while (*methods != NULL){
+	lists = (Method**)objc_array_get_items(method_list, &list_count);
+	for (i = 0; i < list_count; ++i){
+		Method *methods = lists[i];
+		while (*methods != NULL && count < max_count){
 			list[count] = *methods;
 			++count;
 			++methods;
 		}
-		en = en->next;
 	}
 	
 	/* NULL termination */
@@ -69,7 +71,7 @@ Method objc_method_create(SEL selector, const char *types, IMP implementation){
 	Method m = objc_alloc(sizeof(struct objc_method));
 	m->selector = selector;
 	m->implementation = implementation;
-	m->types = objc_strcpy(types);
+	m->types = objc_string_intern(types);
 	m->version = 0;
 	return m;
 }
@@ -81,7 +83,10 @@ IMP objc_method_get_implementation(Method method){
 objc_array objc_method_transform_method_prototypes(struct objc_method_prototype **prototypes){
 	objc_array arr;
 	Method *methods;
-	unsigned int i = 0;
+	const char **names;
+	SEL *selectors;
+	unsigned int count = 0;
+	unsigned int i;
 	
 	if (prototypes == NULL){
 		return NULL;
@@ -89,15 +94,27 @@ objc_array objc_method_transform_method_prototypes(struct objc_method_prototype
 	
 	arr = objc_array_create();
 	
-	while (prototypes[i] != NULL) {
-		struct objc_method_prototype *prototype = prototypes[i];
-		Method m = (Method)prototype;
-		
-		m->selector = objc_selector_register(prototype->selector_name);
-		
-		++i;
+	while (prototypes[count] != NULL) {
+		++count;
+	}
+	
+	/*
+	 * The names need to be collected first - the Method
+	 * structure shares the memory with the prototype, so
+	 * the selector overwrites the selector name.
+	 */
+	names = (const char**)objc_alloc(count * sizeof(const char*) + count * sizeof(SEL));
+	selectors = (SEL*)(names + count);
+	for (i = 0; i < count; ++i){
+		names[i] = prototypes[i]->selector_name;
 	}
 	
+	objc_selector_register_many(names, selectors, count);
+	
+	for (i = 0; i < count; ++i){
+		((Method)prototypes[i])->selector = selectors[i];
+	}
+	objc_dealloc(names);
 	
 	methods = (Method*)prototypes;
 	objc_array_append(arr, methods);
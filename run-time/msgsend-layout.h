@@ -0,0 +1,61 @@
+/*
+ * Layout of the structures read by the assembly implementation
+ * of objc_msg_send (msgsend-x86_64.S).
+ *
+ * This header is included by the assembly source as well, hence it may
+ * only contain preprocessor definitions outside of __ASSEMBLER__. Each
+ * of the offsets is checked at compile time next to the structure it
+ * describes, so that a change of the layout breaks the build rather
+ * than the dispatch.
+ */
+
+#ifndef OBJC_MSGSEND_LAYOUT_H_
+#define OBJC_MSGSEND_LAYOUT_H_
+
+/**
+ * Whether objc_msg_send is implemented in assembly. Currently only
+ * x86-64 with the System V ABI on Linux is supported. Define
+ * OBJC_NO_MSG_SEND_TRAMPOLINE=1 when compiling both the run-time
+ * and the program to use the C fallback instead.
+ */
+#if !defined(OBJC_HAS_MSG_SEND_TRAMPOLINE)
+	#if defined(__x86_64__) && defined(__linux__) && !OBJC_NO_MSG_SEND_TRAMPOLINE
+		#define OBJC_HAS_MSG_SEND_TRAMPOLINE 1
+	#else
+		#define OBJC_HAS_MSG_SEND_TRAMPOLINE 0
+	#endif
+#endif
+
+/* struct objc_class */
+#define OBJC_MSG_SEND_CLASS_CLASS_CACHE_OFFSET 48
+#define OBJC_MSG_SEND_CLASS_INSTANCE_CACHE_OFFSET 56
+
+/* objc_super */
+#define OBJC_MSG_SEND_SUPER_RECEIVER_OFFSET 0
+#define OBJC_MSG_SEND_SUPER_CLASS_OFFSET 8
+
+/* The default cache (structs/cache.c) */
+#define OBJC_MSG_SEND_CACHE_TABLE_OFFSET 8
+#define OBJC_MSG_SEND_TABLE_MASK_OFFSET 0
+#define OBJC_MSG_SEND_TABLE_ENTRIES_OFFSET 8
+#define OBJC_MSG_SEND_ENTRY_SIZE_SHIFT 4
+#define OBJC_MSG_SEND_ENTRY_SELECTOR_OFFSET 0
+#define OBJC_MSG_SEND_ENTRY_IMP_OFFSET 8
+
+/* Reclamation record of a thread (reclaim.c) */
+#define OBJC_MSG_SEND_RECORD_STATE_OFFSET 8
+#define OBJC_MSG_SEND_RECORD_DEPTH_OFFSET 16
+
+#ifndef __ASSEMBLER__
+
+#include <stddef.h>
+
+/**
+ * Fails to compile unless field of type is at offset.
+ */
+#define OBJC_MSG_SEND_CHECK_OFFSET(name, type, field, offset)\
+	typedef char name[(offsetof(type, field) == (offset)) ? 1 : -1]
+
+#endif /* __ASSEMBLER__ */
+
+#endif /* OBJC_MSGSEND_LAYOUT_H_ */
@@ -0,0 +1,22 @@
+/*
+ * C part of objc_msg_send. The functions themselves are implemented
+ * in assembly (msgsend-x86_64.S), or as macros on other targets.
+ */
+
+#include "msgsend.h"
+#include "private.h"
+
+/**
+ * Set by the run-time during initialization if the default cache
+ * is in use - the assembly probes its layout directly.
+ */
+BOOL objc_msg_send_probes_default_cache;
+
+#if OBJC_HAS_MSG_SEND_TRAMPOLINE
+
+OBJC_MSG_SEND_CHECK_OFFSET(_class_cache_offset_check, struct objc_class, class_cache, OBJC_MSG_SEND_CLASS_CLASS_CACHE_OFFSET);
+OBJC_MSG_SEND_CHECK_OFFSET(_instance_cache_offset_check, struct objc_class, instance_cache, OBJC_MSG_SEND_CLASS_INSTANCE_CACHE_OFFSET);
+OBJC_MSG_SEND_CHECK_OFFSET(_super_receiver_offset_check, objc_super, receiver, OBJC_MSG_SEND_SUPER_RECEIVER_OFFSET);
+OBJC_MSG_SEND_CHECK_OFFSET(_super_class_offset_check, objc_super, class, OBJC_MSG_SEND_SUPER_CLASS_OFFSET);
+
+#endif /* OBJC_HAS_MSG_SEND_TRAMPOLINE */
@@ -0,0 +1,49 @@
+/*
+ * This header file contains declarations of the functions
+ * that look up a method implementation and call it in one step.
+ */
+
+#ifndef OBJC_MSGSEND_H_
+#define OBJC_MSGSEND_H_
+
+#include "types.h"
+#include "class.h"
+#include "msgsend-layout.h"
+
+#if OBJC_HAS_MSG_SEND_TRAMPOLINE
+
+/**
+ * Sends a message to receiver - the same as calling the IMP returned
+ * by objc_object_lookup_impl(receiver, selector), but without the extra
+ * call. The implementation is jumped to directly with the arguments
+ * untouched, hence, just like with IMP, cast the function to the exact
+ * type of the method when calling methods with other than id arguments
+ * and return value. Methods that return structures in memory must be
+ * called via objc_object_lookup_impl.
+ *
+ * The class cache is probed right in assembly, the run-time is only
+ * called on a miss, or if a custom cache implementation is in use.
+ */
+extern id objc_msg_send(id receiver, SEL selector, ...);
+
+/**
+ * The same as above for a call to the superclass. The implementation
+ * gets super->receiver as self.
+ */
+extern id objc_msg_send_super(objc_super *super, SEL selector, ...);
+
+#else
+
+/*
+ * Portable fallback. Unlike the assembly implementation, these
+ * evaluate the receiver (or super) and the selector twice.
+ */
+#define _OBJC_MSG_SEND_SELECTOR(selector, ...) (selector)
+#define objc_msg_send(receiver, ...)\
+	(objc_object_lookup_impl((receiver), _OBJC_MSG_SEND_SELECTOR(__VA_ARGS__, 0))((receiver), __VA_ARGS__))
+#define objc_msg_send_super(super, ...)\
+	(objc_object_lookup_impl_super((super), _OBJC_MSG_SEND_SELECTOR(__VA_ARGS__, 0))((super)->receiver, __VA_ARGS__))
+
+#endif /* OBJC_HAS_MSG_SEND_TRAMPOLINE */
+
+#endif /* OBJC_MSGSEND_H_ */
@@ -5,10 +5,14 @@
 #ifndef _OBJC_H_
 #define _OBJC_H_
 
+#include "callsite.h"
 #include "class.h"
 #include "classext.h"
 #include "ftypes.h"
+#include "intern.h"
 #include "method.h"
+#include "msgsend.h"
+#include "reclaim.h"
 #include "runtime.h"
 #include "selector.h"
 #include "types.h"
@@ -36,6 +36,16 @@
 	#define OBJC_ALWAYS_INLINE
 #endif
 
+/**
+ * Storage class specifier of thread-local variables. C99 has
+ * no such keyword, but GCC, Clang and most other compilers
+ * support __thread. Define OBJC_THREAD_LOCAL for compilers
+ * that don't.
+ */
+#if !defined(OBJC_THREAD_LOCAL)
+	#define OBJC_THREAD_LOCAL __thread
+#endif
+
 /* Fallback to false. */
 #if !defined(OBJC_USES_INLINE_FUNCTIONS)
 	#define OBJC_USES_INLINE_FUNCTIONS 1
@@ -86,18 +96,23 @@
 	/* Selector holder */
 	#define objc_selector_holder_create objc_setup.selector_holder.creator
 	#define objc_selector_holder_insert objc_setup.selector_holder.inserter
+	#define objc_selector_holder_bulk_insert objc_setup.selector_holder.bulk_inserter
 	#define objc_selector_holder_lookup objc_setup.selector_holder.lookup
+	#define objc_selector_holder_hashed_lookup objc_setup.selector_holder.hashed_lookup
 
 	/* Array */
 	#define objc_array_create objc_setup.array.creator
 	#define objc_array_append objc_setup.array.append
-	#define objc_array_get_enumerator objc_setup.array.enum_getter
+	#define objc_array_get_items objc_setup.array.items_getter
 
 	/* Cache */
 	#define objc_cache_create objc_setup.cache.creator
 	#define objc_cache_destroy objc_setup.cache.destroyer
 	#define objc_cache_fetch objc_setup.cache.fetcher
+	#define objc_cache_fetch_imp objc_setup.cache.imp_fetcher
 	#define objc_cache_insert objc_setup.cache.inserter
+	#define objc_cache_get_statistics objc_setup.cache.statistics_getter
+	#define objc_cache_derive objc_setup.cache.deriver
 
 #endif
 
@@ -10,6 +10,16 @@
 
 extern BOOL objc_runtime_has_been_initialized;
 
+/**
+ * Initializes structures necessary for string interning.
+ */
+extern void objc_string_intern_init(void);
+
+/**
+ * Sets up the memory reclamation (see reclaim.h).
+ */
+extern void objc_reclaim_init(void);
+
 /**
  * Initializes structures necessary for selector registration.
  */
@@ -18,6 +28,16 @@ extern void objc_selector_init(void);
 /* A pointer to a structure containing all classes */
 extern objc_class_holder objc_classes;
 
+/**
+ * Dispatch generation, see objc_dispatch_get_generation in callsite.h.
+ */
+extern unsigned int objc_dispatch_generation;
+
+/**
+ * Whether objc_msg_send may probe the default cache, see msgsend.c.
+ */
+extern BOOL objc_msg_send_probes_default_cache;
+
 /**
  * Inits basic structures for classes.
  */
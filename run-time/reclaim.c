@@ -0,0 +1,259 @@
+/*
+ * Epoch-based reclamation.
+ *
+ * There is a global epoch. When a thread enters a read-side section,
+ * it records the current global epoch in its own record and marks
+ * the record as active. Retired memory is tagged with the global
+ * epoch at the time of retirement.
+ *
+ * The global epoch may only be advanced once all active threads
+ * have observed it. Hence once the global epoch is two steps ahead
+ * of the tag, every thread that could have seen the memory has left
+ * its section and the memory can be deallocated.
+ *
+ * A thread entering a section must make its record visible before
+ * reading anything, which takes a full barrier on every lookup. Where
+ * the OS allows it (the membarrier system call on Linux), the barrier
+ * is made asymmetric instead: readers only keep the compiler from
+ * reordering the accesses and the thread advancing the epoch makes
+ * all the other threads of the process issue a barrier before looking
+ * at their records. That makes advancing the epoch expensive, hence
+ * the retired memory is only collected once every RECLAIM_COLLECT_INTERVAL
+ * retires, rather than on each one.
+ */
+
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+	/* For syscall, which unistd.h doesn't declare under -std=c99 otherwise. */
+	#define _DEFAULT_SOURCE 1
+#endif
+
+#include "reclaim.h"
+#include "os.h"
+#include "atomic.h"
+#include "msgsend-layout.h"
+#include "private.h" /* For objc_reclaim_init */
+
+#if defined(__linux__)
+	#include <unistd.h>
+	#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && defined(SYS_membarrier)
+	#define RECLAIM_HAS_MEMBARRIER 1
+
+	/* From linux/membarrier.h, which may be missing or too old. */
+	#define RECLAIM_MEMBARRIER_CMD_PRIVATE_EXPEDITED (1 << 3)
+	#define RECLAIM_MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED (1 << 4)
+#else
+	#define RECLAIM_HAS_MEMBARRIER 0
+#endif
+
+/**
+ * Record of a thread.
+ *
+ * next - link in the list of all records.
+ * state - 0 when the thread is outside of a section, otherwise
+ *		the observed epoch shifted left by one with the lowest
+ *		bit set.
+ * depth - nesting level of the sections. Only accessed by the owner.
+ *
+ * Records are never deallocated - a record of a thread that has
+ * exited simply stays inactive.
+ */
+typedef struct _reclaim_record_str {
+	struct _reclaim_record_str *next;
+	unsigned long state;
+	unsigned int depth;
+} *_reclaim_record;
+
+/**
+ * A retired piece of memory along with the epoch it has been retired in.
+ * If destructor is NULL, the memory is simply deallocated.
+ */
+typedef struct _reclaim_retired_str {
+	struct _reclaim_retired_str *next;
+	void *memory;
+	objc_reclaim_destructor_f destructor;
+	unsigned long epoch;
+} *_reclaim_retired;
+
+#define RECLAIM_STATE_ACTIVE ((unsigned long)1)
+
+/**
+ * Number of retires after which the retired memory is collected.
+ */
+#define RECLAIM_COLLECT_INTERVAL 64
+
+unsigned long objc_reclaim_epoch;
+static _reclaim_record records;
+static _reclaim_retired retired_list;
+static unsigned int retired_count;
+
+/*
+ * Not static, as these are read by objc_msg_send (msgsend-x86_64.S)
+ * as well, which enters and leaves the section on its own.
+ *
+ * objc_reclaim_asymmetric_barrier is only set during the run-time
+ * initialization, before there are any readers.
+ */
+OBJC_THREAD_LOCAL _reclaim_record objc_reclaim_current_record;
+int objc_reclaim_asymmetric_barrier;
+
+#if OBJC_HAS_MSG_SEND_TRAMPOLINE
+OBJC_MSG_SEND_CHECK_OFFSET(_record_state_offset_check, struct _reclaim_record_str, state, OBJC_MSG_SEND_RECORD_STATE_OFFSET);
+OBJC_MSG_SEND_CHECK_OFFSET(_record_depth_offset_check, struct _reclaim_record_str, depth, OBJC_MSG_SEND_RECORD_DEPTH_OFFSET);
+#endif
+
+/**
+ * Creates a record for the current thread and adds it to the list.
+ */
+OBJC_INLINE _reclaim_record _reclaim_register_thread(void) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _reclaim_record _reclaim_register_thread(void){
+	_reclaim_record record = (_reclaim_record)objc_zero_alloc(sizeof(struct _reclaim_record_str));
+	_reclaim_record head;
+	do {
+		head = records;
+		record->next = head;
+	} while (!objc_atomic_compare_and_swap(&records, head, record));
+
+	objc_reclaim_current_record = record;
+	return record;
+}
+
+/**
+ * Pushes a retired item onto the retired list.
+ */
+OBJC_INLINE void _reclaim_push_retired(_reclaim_retired item) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _reclaim_push_retired(_reclaim_retired item){
+	_reclaim_retired head;
+	do {
+		head = retired_list;
+		item->next = head;
+	} while (!objc_atomic_compare_and_swap(&retired_list, head, item));
+}
+
+/**
+ * Makes sure the records of the threads that have entered a section
+ * are visible, see the asymmetric barrier above.
+ */
+OBJC_INLINE void _reclaim_heavy_barrier(void) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _reclaim_heavy_barrier(void){
+#if RECLAIM_HAS_MEMBARRIER
+	if (objc_reclaim_asymmetric_barrier){
+		syscall(SYS_membarrier, RECLAIM_MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+		return;
+	}
+#endif
+	objc_atomic_full_barrier();
+}
+
+/**
+ * Advances the global epoch if all active threads have observed
+ * the current one. Returns the global epoch.
+ */
+OBJC_INLINE unsigned long _reclaim_try_advance_epoch(void) OBJC_ALWAYS_INLINE;
+OBJC_INLINE unsigned long _reclaim_try_advance_epoch(void){
+	unsigned long epoch;
+	_reclaim_record record;
+
+	_reclaim_heavy_barrier();
+
+	epoch = objc_atomic_load_acquire(&objc_reclaim_epoch);
+	record = objc_atomic_load_acquire(&records);
+
+	while (record != NULL){
+		unsigned long state = objc_atomic_load_acquire(&record->state);
+		if ((state & RECLAIM_STATE_ACTIVE) != 0 && (state >> 1) != epoch){
+			/* This thread is still in an older epoch. */
+			return epoch;
+		}
+		record = record->next;
+	}
+
+	if (objc_atomic_compare_and_swap(&objc_reclaim_epoch, epoch, epoch + 1)){
+		return epoch + 1;
+	}
+	return objc_atomic_load_acquire(&objc_reclaim_epoch);
+}
+
+/**
+ * Deallocates all retired memory that is safe to deallocate.
+ */
+OBJC_INLINE void _reclaim_collect(void) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _reclaim_collect(void){
+	unsigned long epoch = _reclaim_try_advance_epoch();
+	_reclaim_retired item = objc_atomic_exchange(&retired_list, NULL);
+
+	while (item != NULL){
+		_reclaim_retired next = item->next;
+		if (item->epoch + 2 <= epoch){
+			if (item->destructor != NULL){
+				item->destructor(item->memory);
+			}else{
+				objc_dealloc(item->memory);
+			}
+			objc_dealloc(item);
+		}else{
+			/* Still may be read, put it back. */
+			_reclaim_push_retired(item);
+		}
+		item = next;
+	}
+}
+
+void objc_reclaim_enter(void){
+	_reclaim_record record = objc_reclaim_current_record;
+	if (record == NULL){
+		record = _reclaim_register_thread();
+	}
+
+	if (record->depth++ == 0){
+		unsigned long epoch = objc_atomic_load_relaxed(&objc_reclaim_epoch);
+		objc_atomic_store_relaxed(&record->state, (epoch << 1) | RECLAIM_STATE_ACTIVE);
+
+		/* The state must be visible before anything gets read. */
+		if (objc_reclaim_asymmetric_barrier){
+			objc_atomic_compiler_barrier();
+		}else{
+			objc_atomic_full_barrier();
+		}
+	}
+}
+
+void objc_reclaim_exit(void){
+	_reclaim_record record = objc_reclaim_current_record;
+	if (--record->depth == 0){
+		objc_atomic_store_release(&record->state, 0);
+	}
+}
+
+void objc_reclaim_init(void){
+#if RECLAIM_HAS_MEMBARRIER
+	/* Fails on kernels older than 4.14, the full barrier is used then. */
+	if (syscall(SYS_membarrier, RECLAIM_MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0){
+		objc_reclaim_asymmetric_barrier = 1;
+	}
+#endif
+}
+
+void objc_reclaim_retire(void *memory){
+	objc_reclaim_retire_with_destructor(memory, NULL);
+}
+
+void objc_reclaim_retire_with_destructor(void *memory, objc_reclaim_destructor_f destructor){
+	_reclaim_retired item;
+
+	if (memory == NULL){
+		return;
+	}
+
+	item = (_reclaim_retired)objc_alloc(sizeof(struct _reclaim_retired_str));
+	item->memory = memory;
+	item->destructor = destructor;
+	item->epoch = objc_atomic_load_acquire(&objc_reclaim_epoch);
+	_reclaim_push_retired(item);
+
+	if (objc_atomic_increment(&retired_count) % RECLAIM_COLLECT_INTERVAL == 0){
+		_reclaim_collect();
+	}
+}
@@ -0,0 +1,49 @@
+/*
+ * Safe memory reclamation for the lock-free parts of the run-time.
+ *
+ * The method caches, holders and arrays are read without any locking.
+ * When such a structure is replaced or destroyed, it cannot be
+ * deallocated right away, as other threads may still be reading it.
+ * Instead, it is retired and gets deallocated once no thread
+ * can possibly hold a reference to it.
+ *
+ * This is implemented using epoch-based reclamation: each thread
+ * announces when it starts and finishes reading the lock-free
+ * structures. The announcement only writes into memory owned
+ * by the thread, hence readers never write into shared memory.
+ */
+
+#ifndef OBJC_RECLAIM_H_
+#define OBJC_RECLAIM_H_
+
+#include "types.h"
+
+/**
+ * Marks the beginning and the end of a read-side section. Any
+ * memory retired during the section isn't deallocated until
+ * the section ends.
+ *
+ * Sections may be nested, only the outermost one counts. Do not
+ * block for a long time within a section, as no retired memory
+ * can be deallocated meanwhile.
+ */
+extern void objc_reclaim_enter(void);
+extern void objc_reclaim_exit(void);
+
+/**
+ * Retires memory that has been allocated by objc_alloc or objc_zero_alloc
+ * and is no longer reachable from the shared structures. It gets
+ * deallocated using objc_dealloc once all threads have left the
+ * read-side sections in which they could have reached it.
+ */
+extern void objc_reclaim_retire(void *memory);
+
+/**
+ * The same as objc_reclaim_retire, but the memory is passed to destructor
+ * instead of objc_dealloc. Useful for structures that own resources
+ * that may still be used by the readers, such as locks.
+ */
+typedef void(*objc_reclaim_destructor_f)(void *memory);
+extern void objc_reclaim_retire_with_destructor(void *memory, objc_reclaim_destructor_f destructor);
+
+#endif /* OBJC_RECLAIM_H_ */
@@ -9,6 +9,7 @@
 #include "structs/classhol.h" /* For default class holder imp */
 #include "structs/selechol.h" /* For default selector holder imp */
 #include "structs/cache.h" /* Default cache imp */
+#include "structs/sparse.h" /* Sparse dispatch tables */
 
 /**
  * This is marked during objc_init() as YES. After that point, no modifications
@@ -102,10 +103,58 @@ void objc_runtime_get_setup(objc_runtime_setup_t *setup){
 }
 
 
+/* See header for documentation */
+void objc_runtime_setup_sparse_dispatch_tables(objc_runtime_setup_t *setup){
+#if OBJC_USES_INLINE_FUNCTIONS
+	objc_log("The run-time uses inline functions. Define OBJC_SPARSE_DISPATCH_TABLES to use sparse dispatch tables.\n");
+#else
+	if (setup == NULL){
+		return;
+	}
+	
+	setup->cache.creator = sparse_cache_create;
+	setup->cache.destroyer = sparse_cache_destroy;
+	setup->cache.fetcher = sparse_cache_fetch;
+	setup->cache.imp_fetcher = sparse_cache_fetch_imp;
+	setup->cache.inserter = sparse_cache_insert;
+	setup->cache.statistics_getter = sparse_cache_get_statistics;
+	setup->cache.deriver = sparse_cache_derive;
+#endif
+}
+
+
 static int _objc_runtime_default_log(const char *format, ...){
 	return 0;
 }
 
+#if !OBJC_USES_INLINE_FUNCTIONS
+
+/**
+ * Bulk insert for custom selector holders that don't provide one.
+ */
+static void _objc_runtime_default_selector_holder_bulk_insert(objc_selector_holder holder, SEL *selectors, const unsigned int *hashes, const unsigned int *lengths, unsigned int count){
+	unsigned int i;
+	for (i = 0; i < count; ++i){
+		selectors[i] = objc_setup.selector_holder.inserter(holder, selectors[i]);
+	}
+}
+
+/**
+ * Hashed lookup for custom selector holders that don't provide one.
+ */
+static SEL _objc_runtime_default_selector_holder_hashed_lookup(objc_selector_holder holder, const char *name, unsigned int hash, unsigned int length){
+	return objc_setup.selector_holder.lookup(holder, name);
+}
+
+/**
+ * Deriving for caches that don't provide it - the cache starts empty.
+ */
+static objc_cache _objc_runtime_default_cache_derive(objc_cache superclass_cache, objc_cache_overrides_f overrides, void *context){
+	return objc_setup.cache.creator();
+}
+
+#endif
+
 #define objc_runtime_init_check_function_pointer(struct_path)\
 	if (objc_setup.struct_path == NULL){\
 		objc_setup.execution.abort("No function pointer set for " #struct_path "!\n");\
@@ -139,7 +188,7 @@ static void _objc_runtime_validate_function_pointers(void){
 	
 	objc_runtime_init_check_function_pointer_with_default_imp(array.creator, array_create)
 	objc_runtime_init_check_function_pointer_with_default_imp(array.append, array_add)
-	objc_runtime_init_check_function_pointer_with_default_imp(array.enum_getter, array_get_enumerator)
+	objc_runtime_init_check_function_pointer_with_default_imp(array.items_getter, array_get_items)
 	
 	objc_runtime_init_check_function_pointer_with_default_imp(class_holder.creator, class_holder_create)
 	objc_runtime_init_check_function_pointer_with_default_imp(class_holder.inserter, class_holder_insert_class)
@@ -148,11 +197,24 @@ static void _objc_runtime_validate_function_pointers(void){
 	objc_runtime_init_check_function_pointer_with_default_imp(selector_holder.creator, selector_holder_create)
 	objc_runtime_init_check_function_pointer_with_default_imp(selector_holder.inserter, selector_holder_insert_selector)
 	objc_runtime_init_check_function_pointer_with_default_imp(selector_holder.lookup, selector_holder_lookup_selector)
+	if (objc_setup.selector_holder.inserter == selector_holder_insert_selector){
+		objc_runtime_init_check_function_pointer_with_default_imp(selector_holder.bulk_inserter, selector_holder_insert_selectors)
+	}else{
+		objc_runtime_init_check_function_pointer_with_default_imp(selector_holder.bulk_inserter, _objc_runtime_default_selector_holder_bulk_insert)
+	}
+	if (objc_setup.selector_holder.lookup == selector_holder_lookup_selector){
+		objc_runtime_init_check_function_pointer_with_default_imp(selector_holder.hashed_lookup, selector_holder_lookup_selector_with_hash)
+	}else{
+		objc_runtime_init_check_function_pointer_with_default_imp(selector_holder.hashed_lookup, _objc_runtime_default_selector_holder_hashed_lookup)
+	}
 
 	objc_runtime_init_check_function_pointer_with_default_imp(cache.creator, cache_create)
 	objc_runtime_init_check_function_pointer_with_default_imp(cache.destroyer, cache_destroy)
 	objc_runtime_init_check_function_pointer_with_default_imp(cache.fetcher, cache_fetch)
+	objc_runtime_init_check_function_pointer_with_default_imp(cache.imp_fetcher, cache_fetch_imp)
 	objc_runtime_init_check_function_pointer_with_default_imp(cache.inserter, cache_insert)
+	objc_runtime_init_check_function_pointer_with_default_imp(cache.statistics_getter, cache_get_statistics)
+	objc_runtime_init_check_function_pointer_with_default_imp(cache.deriver, _objc_runtime_default_cache_derive)
 	
 #endif /* OBJC_USES_INLINE_FUNCTIONS */
 }
@@ -174,7 +236,18 @@ void objc_runtime_init(void){
 		_objc_runtime_validate_function_pointers();
 	}
 	
+	/* objc_msg_send only knows the layout of the default cache */
+#if OBJC_USES_INLINE_FUNCTIONS && OBJC_SPARSE_DISPATCH_TABLES
+	objc_msg_send_probes_default_cache = NO;
+#elif OBJC_USES_INLINE_FUNCTIONS
+	objc_msg_send_probes_default_cache = YES;
+#else
+	objc_msg_send_probes_default_cache = (BOOL)(objc_setup.cache.imp_fetcher == cache_fetch_imp);
+#endif
+	
 	/* Initialize inner structures */
+	objc_reclaim_init();
+	objc_string_intern_init();
 	objc_selector_init();
 	objc_class_init();
 	objc_install_base_classes();
@@ -223,6 +296,8 @@ objc_runtime_create_getter_setter_function_body(objc_class_holder_lookup_f, clas
 objc_runtime_create_getter_setter_function_body(objc_selector_holder_creator_f, selector_holder_creator, selector_holder.creator)
 objc_runtime_create_getter_setter_function_body(objc_selector_holder_inserter_f, selector_holder_inserter, selector_holder.inserter)
 objc_runtime_create_getter_setter_function_body(objc_selector_holder_lookup_f, selector_holder_lookup, selector_holder.lookup)
+objc_runtime_create_getter_setter_function_body(objc_selector_holder_bulk_inserter_f, selector_holder_bulk_inserter, selector_holder.bulk_inserter)
+objc_runtime_create_getter_setter_function_body(objc_selector_holder_hashed_lookup_f, selector_holder_hashed_lookup, selector_holder.hashed_lookup)
 
 objc_runtime_create_getter_setter_function_body(objc_log_f, log, logging.log)
 
@@ -233,11 +308,14 @@ objc_runtime_create_getter_setter_function_body(objc_rw_lock_write_lock_f, rw_lo
 objc_runtime_create_getter_setter_function_body(objc_rw_lock_unlock_f, rw_lock_unlock, sync.rwlock.unlock)
 
 objc_runtime_create_getter_setter_function_body(objc_array_creator_f, array_creator, array.creator)
-objc_runtime_create_getter_setter_function_body(objc_array_enumerator_getter_f, array_enumerator_getter, array.enum_getter)
+objc_runtime_create_getter_setter_function_body(objc_array_items_getter_f, array_items_getter, array.items_getter)
 objc_runtime_create_getter_setter_function_body(objc_array_append_f, array_append, array.append)
 
 objc_runtime_create_getter_setter_function_body(objc_cache_creator_f, cache_creator, cache.creator)
 objc_runtime_create_getter_setter_function_body(objc_cache_mark_to_dealloc_f, cache_destroyer, cache.destroyer)
 objc_runtime_create_getter_setter_function_body(objc_cache_fetcher_f, cache_fetcher, cache.fetcher)
+objc_runtime_create_getter_setter_function_body(objc_cache_imp_fetcher_f, cache_imp_fetcher, cache.imp_fetcher)
 objc_runtime_create_getter_setter_function_body(objc_cache_inserter_f, cache_inserter, cache.inserter)
+objc_runtime_create_getter_setter_function_body(objc_cache_statistics_getter_f, cache_statistics_getter, cache.statistics_getter)
+objc_runtime_create_getter_setter_function_body(objc_cache_deriver_f, cache_deriver, cache.deriver)
 
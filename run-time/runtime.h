@@ -35,6 +35,8 @@ typedef struct {
 	objc_selector_holder_creator_f creator;
 	objc_selector_holder_inserter_f inserter;
 	objc_selector_holder_lookup_f lookup;
+	objc_selector_holder_bulk_inserter_f bulk_inserter; /* Optional */
+	objc_selector_holder_hashed_lookup_f hashed_lookup; /* Optional */
 } objc_setup_selector_holder_t;
 
 typedef struct {
@@ -55,7 +57,7 @@ typedef struct {
 
 typedef struct {
 	objc_array_creator_f creator;
-	objc_array_enumerator_getter_f enum_getter;
+	objc_array_items_getter_f items_getter;
 	objc_array_append_f append;
 } objc_setup_array_t;
 
@@ -63,7 +65,10 @@ typedef struct {
 	objc_cache_creator_f creator;
 	objc_cache_mark_to_dealloc_f destroyer;
 	objc_cache_fetcher_f fetcher;
+	objc_cache_imp_fetcher_f imp_fetcher;
 	objc_cache_inserter_f inserter;
+	objc_cache_statistics_getter_f statistics_getter;
+	objc_cache_deriver_f deriver; /* Optional */
 } objc_setup_cache_t;
 
 typedef struct {
@@ -105,6 +110,19 @@ extern void objc_runtime_set_setup(objc_runtime_setup_t *setup);
  */
 extern void objc_runtime_get_setup(objc_runtime_setup_t *setup);
 
+/**
+ * Sets the cache function pointers of the setup structure to
+ * the sparse dispatch tables, which the run-time provides as an
+ * alternative to the default hash-table cache. The sparse tables
+ * are indexed by the selector index instead of being hashed.
+ *
+ * Pass the setup structure to objc_runtime_set_setup() afterwards.
+ *
+ * When the run-time uses inline functions, compile the run-time
+ * with OBJC_SPARSE_DISPATCH_TABLES defined to 1 instead.
+ */
+extern void objc_runtime_setup_sparse_dispatch_tables(objc_runtime_setup_t *setup);
+
 /**
  * Initializers and registering.
  *
@@ -144,6 +162,8 @@ objc_runtime_create_getter_setter_function_decls(objc_class_holder_lookup_f, cla
 
 objc_runtime_create_getter_setter_function_decls(objc_selector_holder_creator_f, selector_holder_creator)
 objc_runtime_create_getter_setter_function_decls(objc_selector_holder_lookup_f, selector_holder_lookup)
+objc_runtime_create_getter_setter_function_decls(objc_selector_holder_bulk_inserter_f, selector_holder_bulk_inserter)
+objc_runtime_create_getter_setter_function_decls(objc_selector_holder_hashed_lookup_f, selector_holder_hashed_lookup)
 
 objc_runtime_create_getter_setter_function_decls(objc_log_f, log)
 
@@ -154,12 +174,15 @@ objc_runtime_create_getter_setter_function_decls(objc_rw_lock_write_lock_f, rw_l
 objc_runtime_create_getter_setter_function_decls(objc_rw_lock_unlock_f, rw_lock_unlock)
 
 objc_runtime_create_getter_setter_function_decls(objc_array_creator_f, array_creator)
-objc_runtime_create_getter_setter_function_decls(objc_array_enumerator_getter_f, array_enumerator_getter)
+objc_runtime_create_getter_setter_function_decls(objc_array_items_getter_f, array_items_getter)
 objc_runtime_create_getter_setter_function_decls(objc_array_append_f, array_append)
 
 objc_runtime_create_getter_setter_function_decls(objc_cache_creator_f, cache_creator)
 objc_runtime_create_getter_setter_function_decls(objc_cache_mark_to_dealloc_f, cache_destroyer)
 objc_runtime_create_getter_setter_function_decls(objc_cache_fetcher_f, cache_fetcher)
+objc_runtime_create_getter_setter_function_decls(objc_cache_imp_fetcher_f, cache_imp_fetcher)
 objc_runtime_create_getter_setter_function_decls(objc_cache_inserter_f, cache_inserter)
+objc_runtime_create_getter_setter_function_decls(objc_cache_statistics_getter_f, cache_statistics_getter)
+objc_runtime_create_getter_setter_function_decls(objc_cache_deriver_f, cache_deriver)
 
 #endif /* OBJC_RUNTIME_H_ */
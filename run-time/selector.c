@@ -1,26 +1,117 @@
 #include "selector.h"
 #include "os.h" /* For run-time functions */
-#include "utils.h" /* For strcpy */
+#include "intern.h" /* For objc_string_intern_with_hash */
+#include "atomic.h" /* For objc_atomic_increment and objc_atomic_add */
+#include "utils.h" /* For objc_hash_string_with_length */
 
 static objc_selector_holder selector_cache;
 
+/* Number of selectors registered so far, used to assign indexes. */
+static unsigned int selector_count;
+
 /* Public functions, documented in the header file. */
 
 SEL objc_selector_register(const char *name){
-	SEL selector = objc_selector_holder_lookup(selector_cache, name);
+	unsigned int length;
+	unsigned int hash;
+	SEL selector;
+	
+	/* The name is hashed just once, for the lookup, the interning and the insert. */
+	hash = objc_hash_string_with_length(name, &length);
+	selector = objc_selector_holder_hashed_lookup(selector_cache, name, hash, length);
 	if (selector == NULL){
-		/* Check if the selector hasn't been added yet */
-		selector = (SEL)objc_selector_holder_lookup(selector_cache, name);
-		if (selector == NULL){
-			/* Still nothing, insert */
-			selector = objc_alloc(sizeof(struct objc_selector));
-			selector->name = objc_strcpy(name);
-			objc_selector_holder_insert(selector_cache, selector);
+		SEL registered_selector;
+		
+		selector = objc_alloc(sizeof(struct objc_selector));
+		selector->name = objc_string_intern_with_hash(name, length, hash);
+		selector->index = objc_atomic_increment(&selector_count) - 1;
+		
+		/*
+		 * Another thread might have registered the same name
+		 * in the meanwhile - the holder then keeps the first
+		 * selector and ours is thrown away. Its index is left
+		 * unused.
+		 */
+		registered_selector = selector;
+		objc_selector_holder_bulk_insert(selector_cache, &registered_selector, &hash, &length, 1);
+		if (registered_selector != selector){
+			objc_dealloc(selector);
+			selector = registered_selector;
 		}
 	}
 	return selector;
 }
 
+void objc_selector_register_many(const char **names, SEL *out, unsigned int count){
+	SEL *new_selectors;
+	SEL *registered_selectors;
+	unsigned int *hashes;
+	unsigned int *lengths;
+	unsigned int new_count = 0;
+	unsigned int index;
+	unsigned int i;
+	
+	if (count == 0){
+		return;
+	}
+	
+	/* Each name is hashed just once, the hashes are kept for the insert. */
+	hashes = (unsigned int*)objc_alloc(2 * count * sizeof(unsigned int));
+	lengths = hashes + count;
+	for (i = 0; i < count; ++i){
+		hashes[i] = objc_hash_string_with_length(names[i], &lengths[i]);
+		out[i] = objc_selector_holder_hashed_lookup(selector_cache, names[i], hashes[i], lengths[i]);
+		if (out[i] == NULL){
+			hashes[new_count] = hashes[i];
+			lengths[new_count] = lengths[i];
+			++new_count;
+		}
+	}
+	
+	if (new_count == 0){
+		objc_dealloc(hashes);
+		return;
+	}
+	
+	/* Claim the indexes for all the new selectors at once. */
+	index = objc_atomic_add(&selector_count, new_count) - new_count;
+	
+	new_selectors = (SEL*)objc_alloc(2 * new_count * sizeof(SEL));
+	registered_selectors = new_selectors + new_count;
+	new_count = 0;
+	for (i = 0; i < count; ++i){
+		if (out[i] == NULL){
+			SEL selector = objc_alloc(sizeof(struct objc_selector));
+			selector->name = objc_string_intern_with_hash(names[i], lengths[new_count], hashes[new_count]);
+			selector->index = index++;
+			new_selectors[new_count] = selector;
+			registered_selectors[new_count] = selector;
+			++new_count;
+		}
+	}
+	
+	objc_selector_holder_bulk_insert(selector_cache, registered_selectors, hashes, lengths, new_count);
+	
+	/*
+	 * A selector that lost a race to another thread, or whose name
+	 * is in names more than once, is thrown away just as in
+	 * objc_selector_register.
+	 */
+	new_count = 0;
+	for (i = 0; i < count; ++i){
+		if (out[i] == NULL){
+			out[i] = registered_selectors[new_count];
+			if (new_selectors[new_count] != out[i]){
+				objc_dealloc(new_selectors[new_count]);
+			}
+			++new_count;
+		}
+	}
+	
+	objc_dealloc(new_selectors);
+	objc_dealloc(hashes);
+}
+
 const char *objc_selector_get_name(SEL selector){
 	if (selector == NULL){
 		return "((null))";
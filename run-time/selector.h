@@ -9,17 +9,21 @@
 /* The selector name is copied over */
 extern SEL objc_selector_register(const char *name);
 
-/* Pointer and name comparison */
+/*
+ * Registers count selectors at once - out[i] is the selector for names[i].
+ * Equivalent to calling objc_selector_register for each name, but the
+ * selectors that haven't been registered yet are inserted together,
+ * taking each lock of the selector holder just once.
+ */
+extern void objc_selector_register_many(const char **names, SEL *out, unsigned int count);
+
+/*
+ * Pointer comparison - objc_selector_register returns the same
+ * SEL for the same name, there is never more than one.
+ */
 OBJC_INLINE BOOL objc_selectors_equal(SEL selector1, SEL selector2) OBJC_ALWAYS_INLINE;
 OBJC_INLINE BOOL objc_selectors_equal(SEL selector1, SEL selector2){
-	if (selector1 == NULL && selector2 == NULL){
-		return YES;
-	}
-	if (selector1 == NULL || selector2 == NULL){
-		return NO;
-	}
-	
-	return selector1 == selector2 || objc_strings_equal(selector1->name, selector2->name);
+	return (BOOL)(selector1 == selector2);
 }
 
 /* Returns the selector name */
@@ -1,66 +1,143 @@
-
+/*
+ * Default objc_array implementation.
+ *
+ * The items are kept in a contiguous storage, so that enumerating
+ * the array is a linear walk over memory. When the storage gets full,
+ * a storage twice as large is allocated, the items are copied over
+ * and the new storage is published as a whole.
+ *
+ * Appending is lock-free - an item is placed into the first empty
+ * slot using compare-and-swap and only then the count is advanced.
+ * Any thread that finds the slot taken advances the count on behalf
+ * of the thread that has taken it, so no one ever waits.
+ *
+ * Readers simply load the current storage and its count. A storage
+ * that has been outgrown is never modified again (it is full), and
+ * is only deallocated along with the array, hence readers that have
+ * loaded it may keep reading it. As the capacity doubles, the outgrown
+ * storages never take more memory than the current one.
+ */
 
 #include "array.h"
 #include "../os.h"
+#include "../atomic.h"
+#include "../reclaim.h"
 
 #if !OBJC_USES_INLINE_FUNCTIONS
 
-/* Internal representation of objc_array */
-typedef struct _array {
-	objc_rw_lock _lock;
-	objc_array_enumerator first;
-	objc_array_enumerator last;
+/**
+ * Capacity of the storage allocated along with the array.
+ */
+#define ARRAY_INITIAL_CAPACITY 4
+
+/**
+ * Structure of a storage.
+ *
+ * previous - the outgrown storage, or NULL.
+ * capacity - number of slots.
+ * count - number of published items.
+ *
+ * The structure is followed by capacity slots.
+ */
+typedef struct _array_storage_str {
+	struct _array_storage_str *previous;
+	unsigned int capacity;
+	unsigned int count;
+} *_array_storage;
+
+/**
+ * Internal representation of objc_array. The initial
+ * storage is allocated right after the structure.
+ */
+typedef struct _array_str {
+	_array_storage storage;
 } *_array;
 
-static void _array_destroy_enumerator(objc_array_enumerator enumerator){
-	if (enumerator == NULL){
-		return;
+OBJC_INLINE void **_array_storage_items(_array_storage storage) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void **_array_storage_items(_array_storage storage){
+	return (void**)(storage + 1);
+}
+
+OBJC_INLINE _array_storage _array_initial_storage(_array arr) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _array_storage _array_initial_storage(_array arr){
+	return (_array_storage)(arr + 1);
+}
+
+/**
+ * Replaces the full storage with one twice as large, unless
+ * someone else has already replaced it.
+ */
+OBJC_INLINE void _array_grow(_array arr, _array_storage storage) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _array_grow(_array arr, _array_storage storage){
+	unsigned int capacity = storage->capacity * 2;
+	_array_storage new_storage = objc_zero_alloc(sizeof(struct _array_storage_str) + capacity * sizeof(void*));
+	unsigned int i;
+
+	/* The storage is full, hence no one is writing into it anymore. */
+	for (i = 0; i < storage->count; ++i){
+		_array_storage_items(new_storage)[i] = _array_storage_items(storage)[i];
+	}
+	new_storage->count = storage->count;
+	new_storage->capacity = capacity;
+	new_storage->previous = storage;
+
+	if (!objc_atomic_compare_and_swap(&arr->storage, storage, new_storage)){
+		/* Someone else has grown the array. */
+		objc_dealloc(new_storage);
 	}
-	
-	_array_destroy_enumerator(enumerator->next);
-	objc_dealloc(enumerator);
 }
 
 objc_array array_create(void){
-	_array arr = objc_alloc(sizeof(struct _array));
-	arr->_lock = objc_rw_lock_create();
-	arr->first = NULL;
+	_array arr = objc_zero_alloc(sizeof(struct _array_str) + sizeof(struct _array_storage_str) + ARRAY_INITIAL_CAPACITY * sizeof(void*));
+	arr->storage = _array_initial_storage(arr);
+	arr->storage->capacity = ARRAY_INITIAL_CAPACITY;
 	return arr;
 }
 void array_destroy(objc_array array){
 	_array arr = (_array)array;
+	_array_storage storage;
 	if (arr == NULL){
 		return;
 	}
-	
-	_array_destroy_enumerator(arr->first);
-	objc_rw_lock_destroy(arr->_lock);
-	objc_dealloc(array);
+
+	storage = arr->storage;
+	while (storage != _array_initial_storage(arr)){
+		_array_storage previous = storage->previous;
+		objc_reclaim_retire(storage);
+		storage = previous;
+	}
+	objc_reclaim_retire(array);
 }
 
 void array_add(objc_array array, void *ptr){
 	_array arr = (_array)array;
-	objc_array_enumerator en;
-	if (arr == NULL){
+	if (arr == NULL || ptr == NULL){
 		return;
 	}
-	
-	en = objc_alloc(sizeof(struct _objc_array_enumerator));
-	en->item = ptr;
-	en->next = NULL;
-	
-	objc_rw_lock_wlock(arr->_lock);
-	if (arr->first == NULL){
-		arr->first = arr->last = en;
-	}else{
-		arr->last->next = en;
-		arr->last = en;
+
+	while (YES){
+		_array_storage storage = objc_atomic_load_acquire(&arr->storage);
+		unsigned int count = objc_atomic_load_acquire(&storage->count);
+
+		if (count == storage->capacity){
+			_array_grow(arr, storage);
+			continue;
+		}
+
+		if (objc_atomic_compare_and_swap(&_array_storage_items(storage)[count], NULL, ptr)){
+			(void)objc_atomic_compare_and_swap(&storage->count, count, count + 1);
+			return;
+		}
+
+		/* The slot has been taken - help publishing it and try the next one. */
+		(void)objc_atomic_compare_and_swap(&storage->count, count, count + 1);
 	}
-	objc_rw_lock_unlock(arr->_lock);
 }
 
-objc_array_enumerator array_get_enumerator(objc_array array){
-	return ((_array)array)->first;
+void **array_get_items(objc_array array, unsigned int *count){
+	_array_storage storage = objc_atomic_load_acquire(&((_array)array)->storage);
+	*count = objc_atomic_load_acquire(&storage->count);
+	return _array_storage_items(storage);
 }
 
 #endif /* OBJC_USES_INLINE_FUNCTIONS */
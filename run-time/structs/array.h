@@ -23,7 +23,8 @@ extern void array_destroy(objc_array array);
 /* Add pointer to the array. */
 extern void array_add(objc_array array, void *ptr);
 
-objc_array_enumerator array_get_enumerator(objc_array array);
+/* Returns the items and stores their number into *count. */
+extern void **array_get_items(objc_array array, unsigned int *count);
 
 #endif /* OBJC_USES_INLINE_FUNCTIONS */
 
@@ -0,0 +1,297 @@
+/*
+ * Default objc_cache implementation.
+ *
+ * The cache is an open-addressed hash table with linear probing.
+ * Each slot keeps the selector and the IMP next to each other,
+ * so that a cache hit costs just a few loads from a single cache
+ * line. The Method pointers are kept in a parallel array, which
+ * is only touched when the Method itself is requested.
+ *
+ * The table starts small and doubles each time it gets over
+ * 3/4 full. Most classes only ever answer a handful of selectors,
+ * while some answer hundreds - a fixed size would either waste
+ * memory on the former or slow down the latter.
+ *
+ * Readers never write into the shared memory - the slots
+ * are only ever filled (never emptied) under a lock and the
+ * selector is published as the last field of the slot. When
+ * the table grows, a new table is populated and then published
+ * as a whole. The old table is retired (see reclaim.h), as there
+ * may still be readers probing it.
+ */
+
+#include "cache.h"
+#include "../os.h"
+#include "../utils.h"
+#include "../atomic.h"
+#include "../reclaim.h"
+#include "../msgsend-layout.h"
+
+#if !OBJC_USES_INLINE_FUNCTIONS
+
+/**
+ * Number of slots of a newly created table. Must be a power of two.
+ */
+#define CACHE_INITIAL_SLOT_COUNT 8
+
+/**
+ * The table never gets filled over 3/4 of its capacity so that
+ * the probe sequences remain short and each of them is terminated
+ * by an empty slot.
+ */
+#define CACHE_IS_OVER_LOAD_FACTOR(count, slot_count) ((count) * 4 > (slot_count) * 3)
+
+/**
+ * A slot of the table. A slot with NULL selector is empty.
+ */
+typedef struct {
+	SEL selector;
+	IMP implementation;
+} _cache_entry;
+
+/**
+ * Structure of the table.
+ *
+ * mask - number of slots - 1.
+ * count - number of filled slots.
+ *
+ * The structure is followed by (mask + 1) _cache_entry slots
+ * and then by (mask + 1) Method pointers.
+ */
+typedef struct _cache_table_str {
+	unsigned int mask;
+	unsigned int count;
+} *_cache_table;
+
+/**
+ * Structure of the cache.
+ *
+ * lock - RW lock, used only for inserting items.
+ * table - the current table. Replaced when the table grows.
+ * resize_count - number of times the table has grown.
+ * destroyed - YES once the cache has been flushed. Inserts are ignored.
+ */
+typedef struct _cache_str {
+	objc_rw_lock lock;
+	_cache_table table;
+	unsigned int resize_count;
+	BOOL destroyed;
+} *_cache;
+
+/*
+ * objc_msg_send probes the table in assembly, see msgsend-layout.h.
+ */
+#if OBJC_HAS_MSG_SEND_TRAMPOLINE
+OBJC_MSG_SEND_CHECK_OFFSET(_cache_table_offset_check, struct _cache_str, table, OBJC_MSG_SEND_CACHE_TABLE_OFFSET);
+OBJC_MSG_SEND_CHECK_OFFSET(_cache_mask_offset_check, struct _cache_table_str, mask, OBJC_MSG_SEND_TABLE_MASK_OFFSET);
+OBJC_MSG_SEND_CHECK_OFFSET(_cache_selector_offset_check, _cache_entry, selector, OBJC_MSG_SEND_ENTRY_SELECTOR_OFFSET);
+OBJC_MSG_SEND_CHECK_OFFSET(_cache_imp_offset_check, _cache_entry, implementation, OBJC_MSG_SEND_ENTRY_IMP_OFFSET);
+typedef char _cache_entries_offset_check[(sizeof(struct _cache_table_str) == OBJC_MSG_SEND_TABLE_ENTRIES_OFFSET) ? 1 : -1];
+typedef char _cache_entry_size_check[(sizeof(_cache_entry) == (1 << OBJC_MSG_SEND_ENTRY_SIZE_SHIFT)) ? 1 : -1];
+#endif
+
+
+OBJC_INLINE _cache_entry *_cache_entries(_cache_table table) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _cache_entry *_cache_entries(_cache_table table){
+	return (_cache_entry*)(table + 1);
+}
+
+OBJC_INLINE Method *_cache_methods(_cache_table table) OBJC_ALWAYS_INLINE;
+OBJC_INLINE Method *_cache_methods(_cache_table table){
+	return (Method*)(_cache_entries(table) + table->mask + 1);
+}
+
+/**
+ * Allocates a new empty table with slot_count slots.
+ */
+OBJC_INLINE _cache_table _cache_table_create(unsigned int slot_count) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _cache_table _cache_table_create(unsigned int slot_count){
+	unsigned long size = sizeof(struct _cache_table_str) + slot_count * (sizeof(_cache_entry) + sizeof(Method));
+	_cache_table table = (_cache_table)objc_zero_alloc(size);
+	table->mask = slot_count - 1;
+	return table;
+}
+
+/**
+ * Returns the index of the slot containing selector,
+ * or -1 if the selector isn't cached.
+ */
+OBJC_INLINE int _cache_index_of_selector(_cache_table table, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE int _cache_index_of_selector(_cache_table table, SEL selector){
+	_cache_entry *entries = _cache_entries(table);
+	unsigned int mask = table->mask;
+	unsigned int index = objc_hash_pointer(selector) & mask;
+
+	while (YES) {
+		SEL slot_selector = objc_atomic_load_acquire(&entries[index].selector);
+		if (slot_selector == selector){
+			return (int)index;
+		}
+		if (slot_selector == NULL){
+			return -1;
+		}
+		index = (index + 1) & mask;
+	}
+}
+
+/**
+ * Returns the index of the first empty slot in the probe sequence
+ * of selector, or -1 if the selector is already in the table.
+ * Must be called with the lock held.
+ */
+OBJC_INLINE int _cache_free_index_for_selector(_cache_table table, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE int _cache_free_index_for_selector(_cache_table table, SEL selector){
+	_cache_entry *entries = _cache_entries(table);
+	unsigned int index = objc_hash_pointer(selector) & table->mask;
+
+	while (entries[index].selector != NULL){
+		if (entries[index].selector == selector){
+			return -1;
+		}
+		index = (index + 1) & table->mask;
+	}
+	return (int)index;
+}
+
+/**
+ * Replaces the table of the cache with one twice as large.
+ * Must be called with the lock held. Returns the new table.
+ */
+OBJC_INLINE _cache_table _cache_grow(_cache cache) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _cache_table _cache_grow(_cache cache){
+	_cache_table old_table = cache->table;
+	_cache_table new_table = _cache_table_create((old_table->mask + 1) * 2);
+	_cache_entry *old_entries = _cache_entries(old_table);
+	_cache_entry *new_entries = _cache_entries(new_table);
+	unsigned int index;
+
+	/* No one can see the new table yet, plain writes are fine. */
+	for (index = 0; index <= old_table->mask; ++index){
+		SEL selector = old_entries[index].selector;
+		int new_index;
+		if (selector == NULL){
+			continue;
+		}
+
+		new_index = _cache_free_index_for_selector(new_table, selector);
+		new_entries[new_index] = old_entries[index];
+		_cache_methods(new_table)[new_index] = _cache_methods(old_table)[index];
+	}
+	new_table->count = old_table->count;
+
+	objc_atomic_store_release(&cache->table, new_table);
+	++cache->resize_count;
+
+	objc_reclaim_retire(old_table);
+	return new_table;
+}
+
+/**
+ * Deallocates a retired cache. The lock is destroyed only now,
+ * as a thread that has loaded the cache before it got flushed
+ * may still be trying to insert into it.
+ */
+OBJC_INLINE void _cache_free(void *cache) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _cache_free(void *cache){
+	objc_rw_lock_destroy(((_cache)cache)->lock);
+	objc_dealloc(cache);
+}
+
+objc_cache cache_create(void){
+	_cache cache = (_cache)objc_zero_alloc(sizeof(struct _cache_str));
+	cache->lock = objc_rw_lock_create();
+	cache->table = _cache_table_create(CACHE_INITIAL_SLOT_COUNT);
+	return (objc_cache)cache;
+}
+Method cache_fetch(objc_cache cache, SEL selector){
+	_cache_table table = objc_atomic_load_acquire(&((_cache)cache)->table);
+	int index = _cache_index_of_selector(table, selector);
+	return index == -1 ? NULL : _cache_methods(table)[index];
+}
+IMP cache_fetch_imp(objc_cache cache, SEL selector){
+	_cache_table table = objc_atomic_load_acquire(&((_cache)cache)->table);
+	int index = _cache_index_of_selector(table, selector);
+	return index == -1 ? NULL : _cache_entries(table)[index].implementation;
+}
+void cache_destroy(objc_cache cache){
+	_cache c = (_cache)cache;
+	_cache_table table;
+
+	/* Make sure no one is writing. */
+	objc_rw_lock_wlock(c->lock);
+
+	c->destroyed = YES;
+	table = c->table;
+
+	objc_rw_lock_unlock(c->lock);
+
+	objc_reclaim_retire(table);
+	objc_reclaim_retire_with_destructor(c, _cache_free);
+}
+void cache_insert(objc_cache cache, SEL selector, Method method){
+	_cache c = (_cache)cache;
+	_cache_table table;
+	int index;
+
+	if (selector == NULL){
+		return;
+	}
+
+	objc_rw_lock_wlock(c->lock);
+
+	table = c->table;
+	index = _cache_free_index_for_selector(table, selector);
+	if (index == -1 || c->destroyed){
+		/* Someone might have inserted it in the meanwhile, or flushed the cache */
+		objc_rw_lock_unlock(c->lock);
+		return;
+	}
+
+	if (CACHE_IS_OVER_LOAD_FACTOR(table->count + 1, table->mask + 1)){
+		table = _cache_grow(c);
+		index = _cache_free_index_for_selector(table, selector);
+	}
+
+	/* The selector must be the last to be visible to the readers. */
+	_cache_methods(table)[index] = method;
+	_cache_entries(table)[index].implementation = method->implementation;
+	objc_atomic_store_release(&_cache_entries(table)[index].selector, selector);
+	++table->count;
+
+	objc_rw_lock_unlock(c->lock);
+}
+void cache_get_statistics(objc_cache cache, objc_cache_statistics *statistics){
+	_cache c = (_cache)cache;
+	_cache_table table;
+	_cache_entry *entries;
+	unsigned int index;
+
+	objc_rw_lock_rlock(c->lock);
+
+	table = c->table;
+	entries = _cache_entries(table);
+
+	statistics->slot_count = table->mask + 1;
+	statistics->entry_count = table->count;
+	statistics->resize_count = c->resize_count;
+	statistics->total_probe_length = 0;
+	statistics->max_probe_length = 0;
+
+	for (index = 0; index <= table->mask; ++index){
+		unsigned int probe_length;
+		if (entries[index].selector == NULL){
+			continue;
+		}
+
+		/* Number of slots a lookup of this selector needs to visit. */
+		probe_length = ((index - objc_hash_pointer(entries[index].selector)) & table->mask) + 1;
+		statistics->total_probe_length += probe_length;
+		if (probe_length > statistics->max_probe_length){
+			statistics->max_probe_length = probe_length;
+		}
+	}
+
+	objc_rw_lock_unlock(c->lock);
+}
+
+#endif /* OBJC_USES_INLINE_FUNCTIONS */
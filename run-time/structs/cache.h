@@ -9,8 +9,10 @@
 
 	extern objc_cache cache_create(void);
 	extern Method cache_fetch(objc_cache cache, SEL selector);
+	extern IMP cache_fetch_imp(objc_cache cache, SEL selector);
 	extern void cache_destroy(objc_cache cache);
-	extern void cache_insert(objc_cache cache, Method method);
+	extern void cache_insert(objc_cache cache, SEL selector, Method method);
+	extern void cache_get_statistics(objc_cache cache, objc_cache_statistics *statistics);
 
 #endif /* OBJC_USES_INLINE_FUNCTIONS */
 
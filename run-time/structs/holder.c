@@ -1,248 +1,372 @@
+/*
+ * Default class and selector holder.
+ *
+ * The holder is split into HOLDER_SHARD_COUNT shards by the top bits
+ * of the name hash, each with its own lock, so that threads registering
+ * different names mostly don't contend for the same lock.
+ *
+ * Each shard is an open-addressed hash table with linear probing. Each
+ * slot keeps the hash and the length of the name next to the object,
+ * so that a probe only compares the strings when both match. The table
+ * doubles each time it gets over 3/4 full.
+ *
+ * Readers never lock, nor write into the shared memory - the slots are
+ * only ever filled (never emptied) under the lock of the shard and the
+ * object is published as the last field of the slot. When the table
+ * grows, a new table is populated and then published as a whole. The
+ * old table is retired (see reclaim.h), as there may still be readers
+ * probing it.
+ */
 
 #include "../os.h"
 #include "../utils.h"
 #include "../private.h"
+#include "../atomic.h"
+#include "../reclaim.h"
 
 #if !OBJC_USES_INLINE_FUNCTIONS
 
 typedef enum {
 	holder_type_selector,
-	holder_type_class,
-	holder_type_cache
+	holder_type_class
 } holder_type;
 
-typedef struct _bucket_struct {
-	struct _bucket_struct *next;
-	void *obj;
-} _bucket;
+/**
+ * Number of shards. Must be a power of two. The shard is
+ * selected by the top HOLDER_SHARD_BITS bits of the hash.
+ */
+#define HOLDER_SHARD_BITS 4
+#define HOLDER_SHARD_COUNT (1 << HOLDER_SHARD_BITS)
 
 /**
- * To make things easier (as this is just a sample structure
- * for the run-time), as well as include less dependencies
- * on the run-time itself, and most importantly, because
- * it's enough, there is a fixed number of buckets in the
- * structure.
+ * Number of slots of a newly created table. Must be a power of two.
  */
-#define HOLDER_BUCKET_COUNT 64
+#define HOLDER_INITIAL_SLOT_COUNT 16
+
+/**
+ * The table never gets filled over 3/4 of its capacity so that
+ * the probe sequences remain short and each of them is terminated
+ * by an empty slot.
+ */
+#define HOLDER_IS_OVER_LOAD_FACTOR(count, slot_count) ((count) * 4 > (slot_count) * 3)
 
 #define OFFSETOF(type, field) ((unsigned int)&(((type *)0)->field))
 
 /**
- * Structure of the actual holder.
+ * A slot of the table. A slot with NULL obj is empty.
+ */
+typedef struct {
+	unsigned int hash;
+	unsigned int length;
+	void *obj;
+} _holder_entry;
+
+/**
+ * Structure of the table.
+ *
+ * mask - number of slots - 1.
+ * count - number of filled slots.
+ *
+ * The structure is followed by (mask + 1) _holder_entry slots.
+ */
+typedef struct _holder_table_str {
+	unsigned int mask;
+	unsigned int count;
+} *_holder_table;
+
+/**
+ * A shard.
  *
  * lock - RW lock, used only for inserting items.
+ * table - the current table. Replaced when the table grows.
+ */
+typedef struct {
+	objc_rw_lock lock;
+	_holder_table table;
+} _holder_shard;
+
+/**
+ * Structure of the actual holder.
+ *
  * type - one of the types above. Used to determine which key to use.
- * buckets - lazily allocated buckets (i.e. NULL at the beginning). This
- *		  can save memory for classes that aren't used by the program
- *		  so that their cache doesn't get allocated unless needed.
  * key_offset_in_object - offset of the key within the obj structure.
- * readers - how many readers are reading from the structure.
- * dealloc_mark - if the structure is marked to be deallocated. If the mark
- *				is YES the structure gets deallocated once readers is
- *				decreased to 0.
- * pointer_equality - whether to simply compare pointers to determine
- *				equality. Implies pointer hash, instead of key hash
- *				as well.
+ * shards - the shards.
  */
 typedef struct _holder_str {
-	objc_rw_lock lock;
-	unsigned int key_offset_in_object;
-	unsigned int readers;
 	holder_type type;
-	BOOL dealloc_mark;
-	BOOL pointer_equality;
-	_bucket **buckets;
+	unsigned int key_offset_in_object;
+	_holder_shard shards[HOLDER_SHARD_COUNT];
 } *_holder;
 
 
+OBJC_INLINE _holder_entry *_holder_entries(_holder_table table) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _holder_entry *_holder_entries(_holder_table table){
+	return (_holder_entry*)(table + 1);
+}
+
 /**
- * Allocates buckets in the holder.
+ * Allocates a new empty table with slot_count slots.
  */
-OBJC_INLINE void _holder_initialize_buckets(_holder holder) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void _holder_initialize_buckets(_holder holder){
-	holder->buckets = objc_zero_alloc(HOLDER_BUCKET_COUNT * sizeof(_bucket*));
+OBJC_INLINE _holder_table _holder_table_create(unsigned int slot_count) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _holder_table _holder_table_create(unsigned int slot_count){
+	_holder_table table = (_holder_table)objc_zero_alloc(sizeof(struct _holder_table_str) + slot_count * sizeof(_holder_entry));
+	table->mask = slot_count - 1;
+	return table;
 }
 
 /**
- * Returns an index in the buckets for a key. The key is either
- * hashed as a pointer, or as a string, depending 
- * on holder->pointer_equality.
+ * Returns the shard for hash.
  */
-OBJC_INLINE unsigned int _bucket_index_for_key(_holder holder, const void *key) OBJC_ALWAYS_INLINE;
-OBJC_INLINE unsigned int _bucket_index_for_key(_holder holder, const void *key){
-	unsigned long hash = holder->pointer_equality ? (unsigned long)key : objc_hash_string((const char*)key);
-	return hash & (HOLDER_BUCKET_COUNT - 1);
+OBJC_INLINE _holder_shard *_holder_shard_for_hash(_holder holder, unsigned int hash) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _holder_shard *_holder_shard_for_hash(_holder holder, unsigned int hash){
+	return &holder->shards[hash >> (sizeof(unsigned int) * 8 - HOLDER_SHARD_BITS)];
 }
 
 /**
- * Looks for an object in a bucket. If not found, NULL is returned.
+ * Returns the key of obj.
  */
-OBJC_INLINE void *_holder_object_in_bucket(_holder holder, _bucket *bucket, void *obj) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void *_holder_object_in_bucket(_holder holder, _bucket *bucket, void *obj){
-	while (bucket != NULL) {
-		if (bucket->obj == obj){
-			/* Already there! */
-			return bucket->obj;
-		}
-		
-		bucket = bucket->next;
-	}
-	return NULL;
+OBJC_INLINE const char *_holder_key_of_object(_holder holder, void *obj) OBJC_ALWAYS_INLINE;
+OBJC_INLINE const char *_holder_key_of_object(_holder holder, void *obj){
+	return *(const char**)((char*)obj + holder->key_offset_in_object);
 }
 
 /**
- * Returns YES if the bucket contains obj.
+ * Returns YES if the first length characters of the strings are equal.
  */
-OBJC_INLINE BOOL _holder_contains_object_in_bucket(_holder holder, _bucket *bucket, void *obj) OBJC_ALWAYS_INLINE;
-OBJC_INLINE BOOL _holder_contains_object_in_bucket(_holder holder, _bucket *bucket, void *obj){
-	return (BOOL)(_holder_object_in_bucket(holder, bucket, obj) != NULL);
+OBJC_INLINE BOOL _holder_keys_equal(const char *key1, const char *key2, unsigned int length) OBJC_ALWAYS_INLINE;
+OBJC_INLINE BOOL _holder_keys_equal(const char *key1, const char *key2, unsigned int length){
+	unsigned int index;
+	for (index = 0; index < length; ++index){
+		if (key1[index] != key2[index]){
+			return NO;
+		}
+	}
+	return YES;
 }
 
 /**
- * Deallocates bucket and all the next buckets.
+ * Looks for an object with key in table. If not found, NULL is returned.
  */
-OBJC_INLINE void _holder_deallocate_bucket(_holder holder, _bucket *bucket) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void _holder_deallocate_bucket(_holder holder, _bucket *bucket){
-	_bucket *next_bucket = bucket;
-	while (next_bucket != NULL){
-		_bucket *current_bucket = next_bucket;
-		next_bucket = current_bucket->next;
-		
-		if (holder->type == holder_type_cache){
-			/** Increase method versions on cache clear. */
-			++((Method)(current_bucket->obj))->version;
+OBJC_INLINE void *_holder_object_in_table_for_key(_holder holder, _holder_table table, const char *key, unsigned int hash, unsigned int length) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void *_holder_object_in_table_for_key(_holder holder, _holder_table table, const char *key, unsigned int hash, unsigned int length){
+	_holder_entry *entries = _holder_entries(table);
+	unsigned int index = hash & table->mask;
+
+	while (YES) {
+		void *obj = objc_atomic_load_acquire(&entries[index].obj);
+		if (obj == NULL){
+			return NULL;
 		}
-		objc_dealloc(current_bucket);
+		if (entries[index].hash == hash && entries[index].length == length
+		    && _holder_keys_equal(_holder_key_of_object(holder, obj), key, length)){
+			return obj;
+		}
+		index = (index + 1) & table->mask;
 	}
 }
 
 /**
- * Deallocates the holder completely.
+ * Returns the index of the first empty slot in the probe sequence
+ * of hash. Must be called with the lock of the shard held.
  */
-OBJC_INLINE void _holder_deallocate(_holder holder) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void _holder_deallocate(_holder holder){
-	unsigned int index = 0;
-	
-	/* Make sure no one is writing. */
-	objc_rw_lock_wlock(holder->lock);
-	
-	for (index = 0; index < HOLDER_BUCKET_COUNT; ++index){
-		if (holder->buckets[index] != NULL){
-			_holder_deallocate_bucket(holder, holder->buckets[index]);
-		}
+OBJC_INLINE unsigned int _holder_free_index_for_hash(_holder_table table, unsigned int hash) OBJC_ALWAYS_INLINE;
+OBJC_INLINE unsigned int _holder_free_index_for_hash(_holder_table table, unsigned int hash){
+	_holder_entry *entries = _holder_entries(table);
+	unsigned int index = hash & table->mask;
+
+	while (entries[index].obj != NULL){
+		index = (index + 1) & table->mask;
 	}
-	
-	objc_dealloc(holder->buckets);
-	objc_rw_lock_unlock(holder->lock);
-	objc_rw_lock_destroy(holder->lock);
+	return index;
 }
 
 /**
- * Returns an object for key.
+ * Replaces the table of the shard with one twice as large.
+ * Must be called with the lock of the shard held. Returns the new table.
  */
-OBJC_INLINE void *_holder_object_in_bucket_for_key(_holder holder, _bucket *bucket, const void *key) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void *_holder_object_in_bucket_for_key(_holder holder, _bucket *bucket, const void *key){
-	while (bucket != NULL) {
-		void *obj_key = *(void**)(((char*)bucket->obj) + holder->key_offset_in_object);
-		BOOL equals = holder->pointer_equality ? (obj_key == key) : objc_strings_equal(key, obj_key);
-		if (equals){
-			/* Already there! */
-			return bucket->obj;
+OBJC_INLINE _holder_table _holder_shard_grow(_holder_shard *shard) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _holder_table _holder_shard_grow(_holder_shard *shard){
+	_holder_table old_table = shard->table;
+	_holder_table new_table = _holder_table_create((old_table->mask + 1) * 2);
+	_holder_entry *old_entries = _holder_entries(old_table);
+	unsigned int index;
+
+	/* No one can see the new table yet, plain writes are fine. */
+	for (index = 0; index <= old_table->mask; ++index){
+		if (old_entries[index].obj != NULL){
+			unsigned int new_index = _holder_free_index_for_hash(new_table, old_entries[index].hash);
+			_holder_entries(new_table)[new_index] = old_entries[index];
 		}
-		
-		bucket = bucket->next;
 	}
-	return NULL;
+	new_table->count = old_table->count;
+
+	objc_atomic_store_release(&shard->table, new_table);
+	objc_reclaim_retire(old_table);
+	return new_table;
 }
 
 /**
- * Inserts an object into holder.
+ * Retires the holder completely. The memory is deallocated once
+ * no readers can be reading it.
  */
-OBJC_INLINE void holder_insert_object_internal(_holder holder, void *obj) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void holder_insert_object_internal(_holder holder, void *obj){
-	unsigned int bucket_index;
-	_bucket *bucket;
-	const void *key;
-	
-	if (holder->buckets == NULL){
-		_holder_initialize_buckets(holder);
-	}
-	
-	key = *(void**)((char*)obj + holder->key_offset_in_object);
-	bucket_index = _bucket_index_for_key(holder, key);
-	if (_holder_contains_object_in_bucket(holder, holder->buckets[bucket_index], obj)){
-		/* Already contains */
-		return;
+OBJC_INLINE void _holder_retire(_holder holder) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _holder_retire(_holder holder){
+	unsigned int index;
+
+	for (index = 0; index < HOLDER_SHARD_COUNT; ++index){
+		_holder_shard *shard = &holder->shards[index];
+
+		/* Make sure no one is writing. */
+		objc_rw_lock_wlock(shard->lock);
+		objc_reclaim_retire(shard->table);
+		objc_rw_lock_unlock(shard->lock);
+		objc_rw_lock_destroy(shard->lock);
 	}
-	
+
+	objc_reclaim_retire(holder);
+}
+
+/**
+ * Inserts an object into the shard, unless an object with the same
+ * key is already there. Returns the object held under the key afterwards.
+ * Must be called with the lock of the shard held.
+ */
+OBJC_INLINE void *_holder_shard_insert_object(_holder holder, _holder_shard *shard, void *obj, const char *key, unsigned int hash, unsigned int length) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void *_holder_shard_insert_object(_holder holder, _holder_shard *shard, void *obj, const char *key, unsigned int hash, unsigned int length){
+	_holder_table table = shard->table;
+	_holder_entry *entry;
+	void *existing;
+
 	/*
-	 * Prepare the bucket before locking in order to
-	 * keep the structure locked as little as possible
+	 * Someone might have inserted an object with the same key
+	 * before we locked - the key stays unique, the existing
+	 * object is returned instead.
 	 */
-	bucket = (_bucket *)objc_alloc(sizeof(_bucket));
-	bucket->obj = obj;
-	
-	/* Lock the structure for insert */
-	objc_rw_lock_wlock(holder->lock);
-	
-	/* Someone might have inserted it between searching and locking */
-	if (_holder_contains_object_in_bucket(holder, holder->buckets[bucket_index], obj)){
-		objc_rw_lock_unlock(holder->lock);
-		objc_dealloc(bucket);
-		return;
+	existing = _holder_object_in_table_for_key(holder, table, key, hash, length);
+	if (existing != NULL){
+		return existing;
+	}
+
+	if (HOLDER_IS_OVER_LOAD_FACTOR(table->count + 1, table->mask + 1)){
+		table = _holder_shard_grow(shard);
 	}
-	
-	bucket->next = holder->buckets[bucket_index];
-	holder->buckets[bucket_index] = bucket;
-	
-	objc_rw_lock_unlock(holder->lock);
+
+	/* The object must be the last to be visible to the readers. */
+	entry = &_holder_entries(table)[_holder_free_index_for_hash(table, hash)];
+	entry->hash = hash;
+	entry->length = length;
+	objc_atomic_store_release(&entry->obj, obj);
+	++table->count;
+
+	return obj;
 }
 
 /**
- * Fetches an object for key.
+ * Inserts an object into holder, unless an object with the same key
+ * is already there. Returns the object held under the key afterwards.
  */
-OBJC_INLINE void *holder_fetch_object(_holder holder, const void *key) OBJC_ALWAYS_INLINE;
-OBJC_INLINE void *holder_fetch_object(_holder holder, const void *key) {
-	_bucket *bucket;
-	void *result;
-	unsigned int bucket_index;
-	
-	if (holder->buckets == NULL){
-		/* No buckets */
-		return NULL;
+OBJC_INLINE void *holder_insert_object_internal(_holder holder, void *obj) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void *holder_insert_object_internal(_holder holder, void *obj){
+	const char *key = _holder_key_of_object(holder, obj);
+	unsigned int length;
+	unsigned int hash = objc_hash_string_with_length(key, &length);
+	_holder_shard *shard = _holder_shard_for_hash(holder, hash);
+
+	objc_rw_lock_wlock(shard->lock);
+	obj = _holder_shard_insert_object(holder, shard, obj, key, hash, length);
+	objc_rw_lock_unlock(shard->lock);
+
+	return obj;
+}
+
+/**
+ * Inserts count objects into holder as if holder_insert_object_internal
+ * was called for each of them, and replaces each of them with the object
+ * held under its key afterwards. The keys have already been hashed by
+ * the caller (see objc_hash_string_with_length). The indexes of the
+ * objects are first bucketed by shard (counting sort, which keeps their
+ * order), so that each shard is then locked just once.
+ */
+OBJC_INLINE void holder_insert_objects_internal(_holder holder, void **objs, const unsigned int *hashes, const unsigned int *lengths, unsigned int count) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void holder_insert_objects_internal(_holder holder, void **objs, const unsigned int *hashes, const unsigned int *lengths, unsigned int count){
+	unsigned int shard_starts[HOLDER_SHARD_COUNT + 1];
+	unsigned int shard_ends[HOLDER_SHARD_COUNT];
+	unsigned int *indexes;
+	unsigned int shard_index;
+	unsigned int i;
+
+	if (count == 0){
+		return;
+	}
+
+	for (shard_index = 0; shard_index <= HOLDER_SHARD_COUNT; ++shard_index){
+		shard_starts[shard_index] = 0;
 	}
-	
-	++holder->readers;
-	
-	/* Check the dealloc mark one more time. */
-	if (holder->dealloc_mark){
-		_holder_deallocate(holder);
-		return NULL;
+	for (i = 0; i < count; ++i){
+		++shard_starts[_holder_shard_for_hash(holder, hashes[i]) - holder->shards + 1];
 	}
-	
-	bucket_index = _bucket_index_for_key(holder, key);
-	bucket = holder->buckets[bucket_index];
-	result = _holder_object_in_bucket_for_key(holder, bucket, key);
-	--holder->readers;
-	
-	if (holder->dealloc_mark && holder->readers == 0){
-		_holder_deallocate(holder);
+	for (shard_index = 0; shard_index < HOLDER_SHARD_COUNT; ++shard_index){
+		shard_starts[shard_index + 1] += shard_starts[shard_index];
+		shard_ends[shard_index] = shard_starts[shard_index];
 	}
-	
-	
+
+	indexes = (unsigned int*)objc_alloc(count * sizeof(unsigned int));
+	for (i = 0; i < count; ++i){
+		indexes[shard_ends[_holder_shard_for_hash(holder, hashes[i]) - holder->shards]++] = i;
+	}
+
+	for (shard_index = 0; shard_index < HOLDER_SHARD_COUNT; ++shard_index){
+		_holder_shard *shard = &holder->shards[shard_index];
+
+		if (shard_starts[shard_index] == shard_ends[shard_index]){
+			continue;
+		}
+
+		objc_rw_lock_wlock(shard->lock);
+		for (i = shard_starts[shard_index]; i < shard_ends[shard_index]; ++i){
+			unsigned int index = indexes[i];
+			objs[index] = _holder_shard_insert_object(holder, shard, objs[index], _holder_key_of_object(holder, objs[index]), hashes[index], lengths[index]);
+		}
+		objc_rw_lock_unlock(shard->lock);
+	}
+
+	objc_dealloc(indexes);
+}
+
+/**
+ * Fetches an object for key, the hash and length of which are known.
+ * Readers neither lock, nor write anything into the holder - the tables
+ * are kept alive by the reclamation read-side section (see reclaim.h).
+ */
+OBJC_INLINE void *holder_fetch_object_with_hash(_holder holder, const char *key, unsigned int hash, unsigned int length) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void *holder_fetch_object_with_hash(_holder holder, const char *key, unsigned int hash, unsigned int length){
+	_holder_shard *shard = _holder_shard_for_hash(holder, hash);
+	void *result;
+
+	objc_reclaim_enter();
+	result = _holder_object_in_table_for_key(holder, objc_atomic_load_acquire(&shard->table), key, hash, length);
+	objc_reclaim_exit();
+
 	return result;
 }
 
 /**
- * Marks the holder as to be deallocated. If no readers are present,
- * it is deallocated at the moment.
+ * Fetches an object for key.
+ */
+OBJC_INLINE void *holder_fetch_object(_holder holder, const char *key) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void *holder_fetch_object(_holder holder, const char *key){
+	unsigned int length;
+	unsigned int hash = objc_hash_string_with_length(key, &length);
+	return holder_fetch_object_with_hash(holder, key, hash, length);
+}
+
+/**
+ * Marks the holder as to be deallocated. It gets deallocated
+ * once no readers can be reading it.
  */
 OBJC_INLINE void holder_mark_to_deallocate(_holder holder) OBJC_ALWAYS_INLINE;
 OBJC_INLINE void holder_mark_to_deallocate(_holder holder){
-	holder->dealloc_mark = YES;
-	if (holder->readers == 0){
-		_holder_deallocate(holder);
-	}
+	_holder_retire(holder);
 }
 
 /**
@@ -252,11 +376,13 @@ OBJC_INLINE void holder_mark_to_deallocate(_holder holder){
 OBJC_INLINE _holder holder_create_internal(holder_type type) OBJC_ALWAYS_INLINE;
 OBJC_INLINE _holder holder_create_internal(holder_type type){
 	_holder holder = (_holder)(objc_alloc(sizeof(struct _holder_str)));
-	holder->buckets = NULL;
-	holder->lock = objc_rw_lock_create();
-	holder->readers = 0;
-	holder->dealloc_mark = NO;
-	holder->pointer_equality = NO;
+	unsigned int index;
+
+	for (index = 0; index < HOLDER_SHARD_COUNT; ++index){
+		holder->shards[index].lock = objc_rw_lock_create();
+		holder->shards[index].table = _holder_table_create(HOLDER_INITIAL_SLOT_COUNT);
+	}
+
 	holder->type = type;
 	switch (type) {
 		case holder_type_class:
@@ -265,15 +391,11 @@ OBJC_INLINE _holder holder_create_internal(holder_type type){
 		case holder_type_selector:
 			holder->key_offset_in_object = OFFSETOF(struct objc_selector, name);
 			break;
-		case holder_type_cache:
-			holder->key_offset_in_object = OFFSETOF(struct objc_method, selector);
-			holder->pointer_equality = YES;
-			break;
 		default:
 			objc_abort("Unknown holder type!");
 			break;
 	}
-	
+
 	return holder;
 }
 
@@ -282,12 +404,18 @@ OBJC_INLINE _holder holder_create_internal(holder_type type){
 objc_selector_holder selector_holder_create(void){
 	return (objc_selector_holder)holder_create_internal(holder_type_selector);
 }
-void selector_holder_insert_selector(objc_selector_holder holder, SEL selector){
-	holder_insert_object_internal((_holder)holder, selector);
+SEL selector_holder_insert_selector(objc_selector_holder holder, SEL selector){
+	return (SEL)holder_insert_object_internal((_holder)holder, selector);
+}
+void selector_holder_insert_selectors(objc_selector_holder holder, SEL *selectors, const unsigned int *hashes, const unsigned int *lengths, unsigned int count){
+	holder_insert_objects_internal((_holder)holder, (void**)selectors, hashes, lengths, count);
 }
 SEL selector_holder_lookup_selector(objc_selector_holder holder, const char *name){
 	return (SEL)holder_fetch_object((_holder)holder, name);
 }
+SEL selector_holder_lookup_selector_with_hash(objc_selector_holder holder, const char *name, unsigned int hash, unsigned int length){
+	return (SEL)holder_fetch_object_with_hash((_holder)holder, name, hash, length);
+}
 
 
 objc_class_holder class_holder_create(void){
@@ -300,17 +428,4 @@ Class class_holder_lookup_class(objc_class_holder holder, const char *name){
 	return (Class)holder_fetch_object((_holder)holder, name);
 }
 
-objc_cache cache_create(void){
-	return (objc_cache)holder_create_internal(holder_type_cache);
-}
-Method cache_fetch(objc_cache cache, SEL selector){
-	return holder_fetch_object((_holder)cache, selector);
-}
-void cache_destroy(objc_cache cache){
-	holder_mark_to_deallocate((_holder)cache);
-}
-void cache_insert(objc_cache cache, Method method){
-	holder_insert_object_internal((_holder)cache, method);
-}
-
 #endif
@@ -11,8 +11,10 @@
  * Functions compatible with declares in function-types.h, section objc_selector_holder.
  */
 extern objc_selector_holder selector_holder_create(void);
-extern void selector_holder_insert_selector(objc_selector_holder holder, SEL selector);
+extern SEL selector_holder_insert_selector(objc_selector_holder holder, SEL selector);
+extern void selector_holder_insert_selectors(objc_selector_holder holder, SEL *selectors, const unsigned int *hashes, const unsigned int *lengths, unsigned int count);
 extern SEL selector_holder_lookup_selector(objc_selector_holder holder, const char *name);
+extern SEL selector_holder_lookup_selector_with_hash(objc_selector_holder holder, const char *name, unsigned int hash, unsigned int length);
 
 
 #endif /* OBJC_USES_INLINE_FUNCTIONS */
@@ -0,0 +1,396 @@
+/*
+ * Sparse dispatch tables - an alternative objc_cache implementation.
+ *
+ * Instead of hashing the selector, the cache is a two-level array
+ * indexed by the dense selector index. The upper bits of the index
+ * select a leaf, the lower bits an entry in the leaf. A lookup is
+ * hence just a few dependent loads with no probing at all.
+ *
+ * Leaves that contain no entries point to a single shared empty
+ * leaf, so that a class answering just a handful of selectors
+ * only allocates the leaves it uses. The shared leaf is never
+ * written to - it is copied on the first write instead. The root
+ * array grows as new selectors get registered, the same way - it is
+ * copied and published as a whole.
+ *
+ * The cache of a subclass is derived from the cache of its superclass
+ * (see sparse_cache_derive): it starts with the leaves of the superclass,
+ * except for the leaves holding selectors the subclass overrides, which
+ * are copied without them. The leaves are reference counted and a leaf
+ * referenced by more than one cache is never written to either - it's
+ * copied on the first write just like the empty leaf, by whichever cache
+ * writes to it first. Subclasses that add a few methods to a large
+ * superclass hence share most of their tables.
+ *
+ * Readers never write into the shared memory, just as in the default
+ * cache implementation. Destroyed caches and outgrown roots are retired
+ * (see reclaim.h) rather than freed right away.
+ *
+ * To use the sparse tables instead of the default cache, see
+ * objc_runtime_setup_sparse_dispatch_tables() in runtime.h.
+ */
+
+#include "sparse.h"
+#include "../os.h"
+#include "../utils.h"
+#include "../atomic.h"
+#include "../reclaim.h"
+
+#if !OBJC_USES_INLINE_FUNCTIONS
+
+/**
+ * Number of entries in a leaf is (1 << SPARSE_LEAF_SHIFT).
+ */
+#define SPARSE_LEAF_SHIFT 5
+#define SPARSE_LEAF_SIZE (1 << SPARSE_LEAF_SHIFT)
+#define SPARSE_LEAF_MASK (SPARSE_LEAF_SIZE - 1)
+
+/**
+ * Number of leaves of a newly created root.
+ */
+#define SPARSE_INITIAL_LEAF_COUNT 4
+
+/**
+ * An entry of a leaf. An entry with NULL implementation is empty.
+ */
+typedef struct {
+	IMP implementation;
+	Method method;
+} _sparse_entry;
+
+/**
+ * Structure of a leaf.
+ *
+ * reference_count - number of caches whose root holds the leaf.
+ * Only changed atomically. A cache may write into the leaf in
+ * place only if it's the only one holding it.
+ */
+typedef struct _sparse_leaf_str {
+	int reference_count;
+	_sparse_entry entries[SPARSE_LEAF_SIZE];
+} *_sparse_leaf;
+
+/**
+ * Structure of the root.
+ *
+ * leaf_count - number of leaves.
+ * leaves - leaf_count leaf pointers.
+ */
+typedef struct _sparse_root_str {
+	unsigned int leaf_count;
+	_sparse_leaf leaves[];
+} *_sparse_root;
+
+/**
+ * Structure of the cache.
+ *
+ * lock - RW lock, used only for inserting items.
+ * root - the current root. Replaced when it grows.
+ * entry_count - number of entries.
+ * allocated_leaf_count - number of leaves other than the empty leaf,
+ * including the ones shared with other caches.
+ * resize_count - number of times the root has grown.
+ * destroyed - YES once the cache has been flushed. Inserts are ignored.
+ */
+typedef struct _sparse_str {
+	objc_rw_lock lock;
+	_sparse_root root;
+	unsigned int entry_count;
+	unsigned int allocated_leaf_count;
+	unsigned int resize_count;
+	BOOL destroyed;
+} *_sparse;
+
+/**
+ * The leaf all empty leaves point to. Never written to.
+ */
+static struct _sparse_leaf_str empty_leaf;
+#define SPARSE_EMPTY_LEAF (&empty_leaf)
+
+
+OBJC_INLINE _sparse_leaf *_sparse_leaves(_sparse_root root) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _sparse_leaf *_sparse_leaves(_sparse_root root){
+	return root->leaves;
+}
+
+/**
+ * Allocates a new leaf holding the entries of leaf, which
+ * may be the empty leaf. Nobody else references it yet.
+ */
+OBJC_INLINE _sparse_leaf _sparse_leaf_copy(_sparse_leaf leaf) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _sparse_leaf _sparse_leaf_copy(_sparse_leaf leaf){
+	_sparse_leaf copy = (_sparse_leaf)objc_alloc(sizeof(*copy));
+	unsigned int i;
+
+	copy->reference_count = 1;
+	for (i = 0; i < SPARSE_LEAF_SIZE; ++i){
+		copy->entries[i] = leaf->entries[i];
+	}
+	return copy;
+}
+
+OBJC_INLINE void _sparse_leaf_retain(_sparse_leaf leaf) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _sparse_leaf_retain(_sparse_leaf leaf){
+	if (leaf != SPARSE_EMPTY_LEAF){
+		objc_atomic_increment(&leaf->reference_count);
+	}
+}
+
+/**
+ * Drops a reference to leaf. The last one to drop it retires it.
+ */
+OBJC_INLINE void _sparse_leaf_release(_sparse_leaf leaf) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _sparse_leaf_release(_sparse_leaf leaf){
+	if (leaf != SPARSE_EMPTY_LEAF && objc_atomic_add(&leaf->reference_count, -1) == 0){
+		objc_reclaim_retire(leaf);
+	}
+}
+
+/**
+ * Allocates a new root with leaf_count leaves. The leaves
+ * of old_root (if not NULL) are copied over, the rest point
+ * to the empty leaf.
+ */
+OBJC_INLINE _sparse_root _sparse_root_create(unsigned int leaf_count, _sparse_root old_root) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _sparse_root _sparse_root_create(unsigned int leaf_count, _sparse_root old_root){
+	_sparse_root root = (_sparse_root)objc_zero_alloc(sizeof(struct _sparse_root_str) + leaf_count * sizeof(_sparse_leaf));
+	_sparse_leaf *leaves = _sparse_leaves(root);
+	unsigned int index = 0;
+
+	if (old_root != NULL){
+		for ( ; index < old_root->leaf_count; ++index){
+			leaves[index] = _sparse_leaves(old_root)[index];
+		}
+	}
+	for ( ; index < leaf_count; ++index){
+		leaves[index] = SPARSE_EMPTY_LEAF;
+	}
+
+	root->leaf_count = leaf_count;
+	return root;
+}
+
+/**
+ * Returns the entry for selector, or NULL if the root doesn't
+ * reach that far. The entry may be empty.
+ */
+OBJC_INLINE _sparse_entry *_sparse_entry_for_selector(_sparse cache, SEL selector) OBJC_ALWAYS_INLINE;
+OBJC_INLINE _sparse_entry *_sparse_entry_for_selector(_sparse cache, SEL selector){
+	_sparse_root root;
+	_sparse_leaf leaf;
+	unsigned int leaf_index;
+
+	if (selector == NULL){
+		return NULL;
+	}
+
+	root = objc_atomic_load_acquire(&cache->root);
+	leaf_index = selector->index >> SPARSE_LEAF_SHIFT;
+	if (leaf_index >= root->leaf_count){
+		return NULL;
+	}
+
+	leaf = objc_atomic_load_acquire(&_sparse_leaves(root)[leaf_index]);
+	return &leaf->entries[selector->index & SPARSE_LEAF_MASK];
+}
+
+/**
+ * Deallocates a retired cache. See _cache_free in cache.c.
+ */
+OBJC_INLINE void _sparse_free(void *cache) OBJC_ALWAYS_INLINE;
+OBJC_INLINE void _sparse_free(void *cache){
+	objc_rw_lock_destroy(((_sparse)cache)->lock);
+	objc_dealloc(cache);
+}
+
+objc_cache sparse_cache_create(void){
+	_sparse cache = (_sparse)objc_zero_alloc(sizeof(struct _sparse_str));
+	cache->lock = objc_rw_lock_create();
+	cache->root = _sparse_root_create(SPARSE_INITIAL_LEAF_COUNT, NULL);
+	return (objc_cache)cache;
+}
+Method sparse_cache_fetch(objc_cache cache, SEL selector){
+	_sparse_entry *entry = _sparse_entry_for_selector((_sparse)cache, selector);
+	return entry == NULL ? NULL : objc_atomic_load_acquire(&entry->method);
+}
+IMP sparse_cache_fetch_imp(objc_cache cache, SEL selector){
+	_sparse_entry *entry = _sparse_entry_for_selector((_sparse)cache, selector);
+	return entry == NULL ? NULL : objc_atomic_load_acquire(&entry->implementation);
+}
+void sparse_cache_destroy(objc_cache cache){
+	_sparse c = (_sparse)cache;
+	_sparse_root root;
+	unsigned int leaf_index;
+
+	/* Make sure no one is writing. */
+	objc_rw_lock_wlock(c->lock);
+
+	c->destroyed = YES;
+	root = c->root;
+	for (leaf_index = 0; leaf_index < root->leaf_count; ++leaf_index){
+		_sparse_leaf_release(_sparse_leaves(root)[leaf_index]);
+	}
+
+	objc_rw_lock_unlock(c->lock);
+
+	objc_reclaim_retire(root);
+	objc_reclaim_retire_with_destructor(c, _sparse_free);
+}
+void sparse_cache_insert(objc_cache cache, SEL selector, Method method){
+	_sparse c = (_sparse)cache;
+	_sparse_root root;
+	_sparse_leaf leaf;
+	unsigned int leaf_index;
+	_sparse_entry *entry;
+
+	if (selector == NULL){
+		return;
+	}
+
+	leaf_index = selector->index >> SPARSE_LEAF_SHIFT;
+
+	objc_rw_lock_wlock(c->lock);
+
+	if (c->destroyed){
+		/* Flushed in the meanwhile */
+		objc_rw_lock_unlock(c->lock);
+		return;
+	}
+
+	root = c->root;
+	if (leaf_index >= root->leaf_count){
+		unsigned int leaf_count = root->leaf_count * 2;
+		while (leaf_index >= leaf_count){
+			leaf_count *= 2;
+		}
+
+		root = _sparse_root_create(leaf_count, c->root);
+		objc_reclaim_retire(c->root);
+		objc_atomic_store_release(&c->root, root);
+		++c->resize_count;
+	}
+
+	leaf = _sparse_leaves(root)[leaf_index];
+	entry = &leaf->entries[selector->index & SPARSE_LEAF_MASK];
+	if (entry->implementation != NULL){
+		/* Someone might have inserted it in the meanwhile */
+		objc_rw_lock_unlock(c->lock);
+		return;
+	}
+
+	/*
+	 * The count includes the reference of this cache, hence if it's 1,
+	 * no one else can start sharing the leaf while the lock is held.
+	 */
+	if (leaf == SPARSE_EMPTY_LEAF || objc_atomic_load_acquire(&leaf->reference_count) > 1){
+		/* Copy on write - the leaf is published with the entry filled in. */
+		_sparse_leaf shared_leaf = leaf;
+		leaf = _sparse_leaf_copy(shared_leaf);
+		entry = &leaf->entries[selector->index & SPARSE_LEAF_MASK];
+		entry->method = method;
+		entry->implementation = method->implementation;
+		objc_atomic_store_release(&_sparse_leaves(root)[leaf_index], leaf);
+		if (shared_leaf == SPARSE_EMPTY_LEAF){
+			++c->allocated_leaf_count;
+		}
+		_sparse_leaf_release(shared_leaf);
+	}else{
+		/* The IMP must be the last to be visible to the readers. */
+		objc_atomic_store_release(&entry->method, method);
+		objc_atomic_store_release(&entry->implementation, method->implementation);
+	}
+	++c->entry_count;
+
+	objc_rw_lock_unlock(c->lock);
+}
+void sparse_cache_get_statistics(objc_cache cache, objc_cache_statistics *statistics){
+	_sparse c = (_sparse)cache;
+
+	objc_rw_lock_rlock(c->lock);
+
+	statistics->slot_count = c->allocated_leaf_count * SPARSE_LEAF_SIZE;
+	statistics->entry_count = c->entry_count;
+	statistics->resize_count = c->resize_count;
+
+	/* Each lookup visits exactly one entry. */
+	statistics->max_probe_length = c->entry_count == 0 ? 0 : 1;
+	statistics->total_probe_length = c->entry_count;
+
+	objc_rw_lock_unlock(c->lock);
+}
+objc_cache sparse_cache_derive(objc_cache superclass_cache, objc_cache_overrides_f overrides, void *context){
+	_sparse parent = (_sparse)superclass_cache;
+	_sparse cache = (_sparse)objc_zero_alloc(sizeof(struct _sparse_str));
+	_sparse_leaf *leaves;
+	unsigned int leaf_index;
+
+	cache->lock = objc_rw_lock_create();
+
+	/* The writers of the superclass' cache are kept out while its leaves get shared. */
+	objc_rw_lock_rlock(parent->lock);
+
+	if (parent->destroyed){
+		/* Flushed in the meanwhile, its leaves may be gone */
+		objc_rw_lock_unlock(parent->lock);
+		cache->root = _sparse_root_create(SPARSE_INITIAL_LEAF_COUNT, NULL);
+		return (objc_cache)cache;
+	}
+
+	cache->root = _sparse_root_create(parent->root->leaf_count, parent->root);
+	leaves = _sparse_leaves(cache->root);
+	for (leaf_index = 0; leaf_index < cache->root->leaf_count; ++leaf_index){
+		_sparse_leaf_retain(leaves[leaf_index]);
+	}
+
+	objc_rw_lock_unlock(parent->lock);
+
+	/*
+	 * Being shared, the leaves won't be written to anymore. The ones
+	 * holding overridden selectors are replaced by copies without them.
+	 * No one else can see the new cache yet.
+	 */
+	for (leaf_index = 0; leaf_index < cache->root->leaf_count; ++leaf_index){
+		_sparse_leaf leaf = leaves[leaf_index];
+		_sparse_leaf copy = NULL;
+		unsigned int entry_count = 0;
+		unsigned int i;
+
+		if (leaf == SPARSE_EMPTY_LEAF){
+			continue;
+		}
+
+		for (i = 0; i < SPARSE_LEAF_SIZE; ++i){
+			if (leaf->entries[i].implementation == NULL){
+				continue;
+			}
+
+			if (overrides(context, leaf->entries[i].method->selector)){
+				if (copy == NULL){
+					copy = _sparse_leaf_copy(leaf);
+				}
+				copy->entries[i].implementation = NULL;
+				copy->entries[i].method = NULL;
+			}else{
+				++entry_count;
+			}
+		}
+
+		if (copy != NULL){
+			_sparse_leaf_release(leaf);
+			if (entry_count == 0){
+				objc_dealloc(copy);
+				copy = SPARSE_EMPTY_LEAF;
+			}
+			leaves[leaf_index] = copy;
+		}
+
+		if (entry_count != 0){
+			++cache->allocated_leaf_count;
+			cache->entry_count += entry_count;
+		}
+	}
+
+	return (objc_cache)cache;
+}
+
+#endif /* OBJC_USES_INLINE_FUNCTIONS */
@@ -0,0 +1,19 @@
+#ifndef SPARSE_H_
+#define SPARSE_H_
+
+#include "../os.h"
+#if !OBJC_USES_INLINE_FUNCTIONS
+
+	#include "../types.h"
+
+	extern objc_cache sparse_cache_create(void);
+	extern Method sparse_cache_fetch(objc_cache cache, SEL selector);
+	extern IMP sparse_cache_fetch_imp(objc_cache cache, SEL selector);
+	extern void sparse_cache_destroy(objc_cache cache);
+	extern void sparse_cache_insert(objc_cache cache, SEL selector, Method method);
+	extern void sparse_cache_get_statistics(objc_cache cache, objc_cache_statistics *statistics);
+	extern objc_cache sparse_cache_derive(objc_cache superclass_cache, objc_cache_overrides_f overrides, void *context);
+
+#endif /* OBJC_USES_INLINE_FUNCTIONS */
+
+#endif /* SPARSE_H_ */
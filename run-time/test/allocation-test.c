@@ -1,5 +1,18 @@
 #include "testing.h"
 
+/*
+ * Compares creating and deallocating instances one by one with doing so
+ * in bulk. The bulk deallocation gets instances of two classes mixed
+ * together along with nil entries.
+ */
+
+#define BULK_COUNT 64
+#define BULK_ITERATIONS (ALLOCATION_ITERATIONS / BULK_COUNT)
+
+static id bulk_objects[BULK_COUNT + BULK_COUNT / 4];
+static id bulk_class_objects[BULK_COUNT];
+static id bulk_subclass_objects[BULK_COUNT];
+
 static clock_t allocation_test(void){
 	clock_t c1, c2;
 	int i;
@@ -14,9 +27,54 @@ static clock_t allocation_test(void){
 	return (c2 - c1);
 }
 
+static clock_t bulk_allocation_test(void){
+	Class cl = objc_class_for_name("MyClass");
+	Class subclass = objc_class_for_name("MySubclass");
+	unsigned int destructed_before = destructed_object_count;
+	BOOL created = YES;
+	clock_t c1, c2;
+	int i, o;
+	
+	c1 = clock();
+	for (i = 0; i < BULK_ITERATIONS; ++i){
+		unsigned int count = 0;
+		
+		objc_class_create_instances(cl, BULK_COUNT / 2, bulk_class_objects);
+		objc_class_create_instances(subclass, BULK_COUNT / 2, bulk_subclass_objects);
+		
+		/* Alternates the classes, every fourth entry is followed by nil. */
+		for (o = 0; o < BULK_COUNT / 2; ++o){
+			bulk_objects[count++] = bulk_class_objects[o];
+			bulk_objects[count++] = bulk_subclass_objects[o];
+			if (o % 2 == 1){
+				bulk_objects[count++] = nil;
+			}
+		}
+		
+		created = created && bulk_class_objects[BULK_COUNT / 2 - 1] != nil && bulk_class_objects[BULK_COUNT / 2 - 1]->isa == cl
+				&& bulk_subclass_objects[BULK_COUNT / 2 - 1] != nil && bulk_subclass_objects[BULK_COUNT / 2 - 1]->isa == subclass;
+		
+		objc_objects_deallocate(bulk_objects, count);
+	}
+	c2 = clock();
+	
+	if (!created || destructed_object_count - destructed_before != BULK_ITERATIONS * BULK_COUNT){
+		printf("Correctness condition false for test bulk allocation!\n");
+		objc_abort("");
+	}
+	
+	return (c2 - c1);
+}
+
 
 int main(int argc, const char * argv[]){
+	register_counting_extension();
 	register_classes();
+	
+	printf("One by one:\n");
 	perform_tests(allocation_test);
+	
+	printf("Bulk:\n");
+	perform_tests(bulk_allocation_test);
 	return 0;
 }
@@ -0,0 +1,139 @@
+#define OBJC_HAS_CATEGORIES_EXTENSION 1
+#include "testing.h"
+
+/*
+ * Compares dispatching through a class using eager dispatch with
+ * dispatching through the same hierarchy without it, after checking
+ * that the dispatch tables of eager classes reflect the methods added
+ * after the classes have been finished.
+ */
+
+static Class eager_class;
+static Class eager_subclass;
+static Class lazy_subclass;
+
+static SEL eager_selector;
+static int eager_counter;
+
+static id _I_EagerClass_one_(id self, SEL _cmd){
+	return (id)1;
+}
+
+static id _I_EagerClass_two_(id self, SEL _cmd){
+	return (id)2;
+}
+
+static id _I_EagerClass_three_(id self, SEL _cmd){
+	return (id)3;
+}
+
+static void _I_EagerClass_increment_(id self, SEL _cmd){
+	++eager_counter;
+}
+
+static struct objc_method_prototype _I_EagerClassCategory_categoryMethod_mp_ = {
+	"eagerCategoryMethod",
+	"@@:",
+	(IMP)_I_EagerClass_three_,
+	0
+};
+
+static struct objc_method_prototype *EagerClass_Category_instance_methods[] = {
+	&_I_EagerClassCategory_categoryMethod_mp_,
+	NULL
+};
+
+static struct objc_category_prototype _EagerClass_Category_category_prototype_ = {
+	"EagerClass",
+	"Category",
+	NULL,
+	EagerClass_Category_instance_methods
+};
+
+static id send(id obj, const char *name){
+	SEL selector = objc_selector_register(name);
+	IMP impl = objc_object_lookup_impl(obj, selector);
+	return ((id(*)(id, SEL))impl)(obj, selector);
+}
+
+static void register_eager_classes(void){
+	Class cl = objc_class_for_name("MyClass");
+	id instance;
+
+	eager_class = objc_class_create(cl, "EagerClass");
+	objc_class_set_eager_dispatch(eager_class, YES);
+	objc_class_add_instance_method(eager_class, objc_method_create(objc_selector_register("eagerMethod"), "@@:", (IMP)_I_EagerClass_one_));
+	objc_class_add_instance_method(eager_class, objc_method_create(objc_selector_register("eagerReplacedMethod"), "@@:", (IMP)_I_EagerClass_one_));
+	objc_class_finish(eager_class);
+
+	eager_subclass = objc_class_create(eager_class, "EagerSubclass");
+	objc_class_finish(eager_subclass);
+	check_condition(eager_subclass->flags.eager_dispatch, "eager dispatch - the subclass inherits eager dispatch");
+
+	instance = objc_class_create_instance(eager_subclass);
+	check_condition(send(instance, "eagerMethod") == (id)1, "eager dispatch - inherited method");
+	check_condition(!objc_class_responds_to_instance_selector(eager_subclass, objc_selector_register("eagerAddedMethod")), "eager dispatch - missing method");
+
+	objc_class_add_instance_method(eager_class, objc_method_create(objc_selector_register("eagerAddedMethod"), "@@:", (IMP)_I_EagerClass_two_));
+	check_condition(send(instance, "eagerAddedMethod") == (id)2, "eager dispatch - method added after finishing");
+
+	objc_class_add_instance_method(cl, objc_method_create(objc_selector_register("eagerSuperclassMethod"), "@@:", (IMP)_I_EagerClass_three_));
+	check_condition(send(instance, "eagerSuperclassMethod") == (id)3, "eager dispatch - method added to the superclass");
+
+	objc_class_register_category_prototype(&_EagerClass_Category_category_prototype_);
+	check_condition(send(instance, "eagerCategoryMethod") == (id)3, "eager dispatch - category method");
+
+	objc_class_replace_instance_method_implementation(eager_class, objc_selector_register("eagerReplacedMethod"), (IMP)_I_EagerClass_two_, "@@:");
+	check_condition(send(instance, "eagerReplacedMethod") == (id)2, "eager dispatch - replaced implementation");
+
+	objc_object_deallocate(instance);
+
+	/* Added once both subclasses are finished, the eager one needs to pick it up from a rebuilt table. */
+	lazy_subclass = objc_class_create(cl, "LazySubclass");
+	objc_class_finish(lazy_subclass);
+
+	eager_selector = objc_selector_register("eagerIncrement");
+	objc_class_add_instance_method(cl, objc_method_create(eager_selector, "v@:", (IMP)_I_EagerClass_increment_));
+}
+
+static clock_t dispatch_test(Class cl){
+	id instance = objc_class_create_instance(cl);
+	clock_t c1, c2;
+	int i;
+
+	eager_counter = 0;
+	c1 = clock();
+	for (i = 0; i < DISPATCH_ITERATIONS; ++i){
+		IMP impl = objc_object_lookup_impl(instance, eager_selector);
+		((void(*)(id, SEL))impl)(instance, eager_selector);
+	}
+	c2 = clock();
+
+	if (eager_counter != DISPATCH_ITERATIONS){
+		printf("Correctness condition false for test dispatch in %s!\n", objc_class_get_name(cl));
+		objc_abort("");
+	}
+
+	objc_object_deallocate(instance);
+	return (c2 - c1);
+}
+
+static clock_t eager_dispatch_test(void){
+	return dispatch_test(eager_subclass);
+}
+
+static clock_t lazy_dispatch_test(void){
+	return dispatch_test(lazy_subclass);
+}
+
+int main(int argc, const char * argv[]){
+	register_classes();
+	register_eager_classes();
+
+	printf("Eager dispatch:\n");
+	perform_tests(eager_dispatch_test);
+
+	printf("Regular dispatch:\n");
+	perform_tests(lazy_dispatch_test);
+	return 0;
+}
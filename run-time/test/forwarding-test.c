@@ -13,7 +13,12 @@ static void _I_NewClass_unknownSelector(id self, SEL _cmd, int i){
 	}
 }
 
-static clock_t forwarding_test(void){
+/**
+ * Forwards either via objc_object_lookup_impl, or via
+ * objc_object_lookup_method - both use the forwarding cache.
+ */
+static clock_t forwarding_test(BOOL via_method){
+	SEL unknown_selector = objc_selector_register("unknownSelector:");
 	id new_class_instance;
 	MyClass *my_class_instance;
 	clock_t c1, c2;
@@ -23,11 +28,18 @@ static clock_t forwarding_test(void){
 	my_class_instance = (MyClass*)objc_class_create_instance(objc_class_for_name("MyClass"));
 	my_class_instance->proxyObject = new_class_instance;
 	
+	reachedLastIteration = NO;
+	
 	c1 = clock();
 	for (i = 0; i < DISPATCH_ITERATIONS; ++i){
 		SEL selector = NULL;
 		IMP impl = NULL;
-		OBJC_GET_IMP((id)my_class_instance, "unknownSelector:", selector, impl);
+		if (via_method){
+			selector = unknown_selector;
+			impl = objc_method_get_implementation(objc_object_lookup_method((id)my_class_instance, selector));
+		}else{
+			OBJC_GET_IMP((id)my_class_instance, "unknownSelector:", selector, impl);
+		}
 		impl((id)my_class_instance, selector, i);
 	}
 	c2 = clock();
@@ -44,6 +56,51 @@ static clock_t forwarding_test(void){
 	return (c2 - c1);
 }
 
+static id _I_NewClass_replacedSelector_old(id self, SEL _cmd){
+	return (id)1;
+}
+
+static id _I_NewClass_replacedSelector_new(id self, SEL _cmd){
+	return (id)2;
+}
+
+/**
+ * The forwarding cache of MyClass must not keep returning
+ * an implementation of NewClass that has been replaced.
+ */
+static void check_replaced_forwarded_implementation(void){
+	SEL selector = objc_selector_register("replacedSelector");
+	Class new_class = objc_class_for_name("NewClass");
+	id new_class_instance = objc_class_create_instance(new_class);
+	MyClass *my_class_instance = (MyClass*)objc_class_create_instance(objc_class_for_name("MyClass"));
+	int i;
+	
+	my_class_instance->proxyObject = new_class_instance;
+	
+	objc_class_add_instance_method(new_class, objc_method_create(selector, "@@:", (IMP)_I_NewClass_replacedSelector_old));
+	
+	/* The second lookup hits the forwarding cache. */
+	for (i = 0; i < 2; ++i){
+		check_condition(objc_object_lookup_impl((id)my_class_instance, selector) == (IMP)_I_NewClass_replacedSelector_old, "test forwarding - forwarded implementation");
+	}
+	
+	objc_class_replace_instance_method_implementation(new_class, selector, (IMP)_I_NewClass_replacedSelector_new, "@@:");
+	
+	check_condition(objc_object_lookup_impl((id)my_class_instance, selector) == (IMP)_I_NewClass_replacedSelector_new
+		&& objc_method_get_implementation(objc_object_lookup_method((id)my_class_instance, selector)) == (IMP)_I_NewClass_replacedSelector_new, "test forwarding - replaced forwarded implementation");
+	
+	objc_object_deallocate((id)my_class_instance);
+	objc_object_deallocate(new_class_instance);
+}
+
+static clock_t impl_forwarding_test(void){
+	return forwarding_test(NO);
+}
+
+static clock_t method_forwarding_test(void){
+	return forwarding_test(YES);
+}
+
 int main(int argc, const char * argv[]){
 	register_classes();
 	
@@ -55,7 +112,13 @@ int main(int argc, const char * argv[]){
 		objc_class_finish(completely_new_class);	
 	}
 	
-	perform_tests(forwarding_test);
+	check_replaced_forwarded_implementation();
+	
+	printf("Implementation lookup:\n");
+	perform_tests(impl_forwarding_test);
+	
+	printf("Method lookup:\n");
+	perform_tests(method_forwarding_test);
 	return 0;
 }
 
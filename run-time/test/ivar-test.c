@@ -7,8 +7,160 @@ GENERATE_TEST(ivar, "MySubclass", {}, DISPATCH_ITERATIONS, {
 	impl((id)instance, selector);
 }, (*((int*)(objc_object_get_variable((id)instance, objc_class_get_ivar(objc_class_for_name("MySubclass"), "i")))) == DISPATCH_ITERATIONS))
 
+GENERATE_TEST(typed_ivar, "MySubclass", {}, DISPATCH_ITERATIONS, {
+	Ivar i_ivar = objc_class_get_ivar(instance->isa, "i");
+	objc_object_set_variable_32((id)instance, i_ivar, objc_object_get_variable_32((id)instance, i_ivar) + 1);
+}, (objc_object_get_variable_32((id)instance, objc_class_get_ivar(objc_class_for_name("MySubclass"), "i")) == DISPATCH_ITERATIONS))
+
+/* Hides the i ivar of MyClass. */
+static struct objc_ivar _IvarHidingClass_i_ivar_ = {
+	"i",
+	"i",
+	sizeof(int),
+	sizeof(id) * 3
+};
+
+static Ivar _IvarHidingClass_ivars_[] = {
+	&_IvarHidingClass_i_ivar_,
+	NULL
+};
+
+static struct objc_class_prototype IvarHidingClass_class = {
+	NULL, /** isa pointer gets connected when registering. */
+	"MyClass", /** Superclass */
+	"IvarHidingClass",
+	NULL, /** Class methods */
+	NULL, /** Instance methods */
+	_IvarHidingClass_ivars_, /** Ivars */
+	NULL, /** Class cache. */
+	NULL, /** Instance cache. */
+	0, /** Instance size - computed from ivars. */
+	0, /** Version. */
+	{
+		YES /** In construction. */
+	},
+	NULL /** Extra space. */
+};
+
+/*
+ * Checks that the typed accessors only touch their own ivar.
+ */
+static void check_typed_accessors(void){
+	Class cl = objc_class_create(Nil, "TypedIvarClass");
+	Ivar i8, i16, i32, i64, pointer;
+	id instance;
+	
+	objc_class_add_ivar(cl, "isa", sizeof(Class), __alignof(Class), "#");
+	i8 = objc_class_add_ivar(cl, "i8", sizeof(uint8_t), sizeof(uint8_t), "C");
+	i16 = objc_class_add_ivar(cl, "i16", sizeof(uint16_t), sizeof(uint16_t), "S");
+	i32 = objc_class_add_ivar(cl, "i32", sizeof(uint32_t), sizeof(uint32_t), "I");
+	i64 = objc_class_add_ivar(cl, "i64", sizeof(uint64_t), sizeof(uint64_t), "Q");
+	pointer = objc_class_add_ivar(cl, "pointer", sizeof(void*), sizeof(void*), "^v");
+	objc_class_finish(cl);
+	
+	instance = objc_class_create_instance(cl);
+	objc_object_set_variable_8(instance, i8, 0xAB);
+	objc_object_set_variable_16(instance, i16, 0xABCD);
+	objc_object_set_variable_32(instance, i32, 0xABCDEF01U);
+	objc_object_set_variable_64(instance, i64, 0xABCDEF0123456789ULL);
+	objc_object_set_variable_pointer(instance, pointer, instance);
+	
+	check_condition(objc_object_get_variable_8(instance, i8) == 0xAB, "ivars - 8-bit accessors");
+	check_condition(objc_object_get_variable_16(instance, i16) == 0xABCD, "ivars - 16-bit accessors");
+	check_condition(objc_object_get_variable_32(instance, i32) == 0xABCDEF01U, "ivars - 32-bit accessors");
+	check_condition(objc_object_get_variable_64(instance, i64) == 0xABCDEF0123456789ULL, "ivars - 64-bit accessors");
+	check_condition(objc_object_get_variable_pointer(instance, pointer) == instance, "ivars - pointer accessors");
+	check_condition(instance->isa == cl, "ivars - isa is untouched by the accessors");
+	check_condition(*(uint32_t*)objc_object_get_variable(instance, i32) == 0xABCDEF01U, "ivars - typed and untyped accessors agree");
+	
+	check_condition(objc_object_get_variable_32(nil, i32) == 0 && objc_object_get_variable_pointer(instance, NULL) == NULL, "ivars - accessors of nil");
+	objc_object_deallocate(instance);
+}
+
+/*
+ * Checks the ivar lookup by name, which goes through the ivar index,
+ * including an ivar hidden by a subclass ivar of the same name.
+ */
+static void check_ivar_index(void){
+	Class cl = objc_class_for_name("MyClass");
+	Class subclass = objc_class_for_name("MySubclass");
+	Class hiding_class = objc_class_register_prototype(&IvarHidingClass_class);
+	int i_value = 7;
+	int out_value = 0;
+	void *value = &out_value;
+	id instance;
+	
+	check_condition(objc_class_get_ivar(cl, "i") == &_MyClass_isa_i_ivar_, "ivars - lookup of a declared ivar");
+	check_condition(objc_class_get_ivar(subclass, "i") == &_MyClass_isa_i_ivar_, "ivars - lookup of an inherited ivar");
+	check_condition(objc_class_get_ivar(subclass, "missing") == NULL, "ivars - lookup of a missing ivar");
+	check_condition(objc_class_get_ivar(hiding_class, "i") == &_IvarHidingClass_i_ivar_, "ivars - lookup of a hiding ivar");
+	check_condition(objc_class_get_ivar(hiding_class, "proxyObject") == &_MyClass_isa_proxyObject_ivar_, "ivars - lookup next to a hiding ivar");
+	
+	instance = objc_class_create_instance(hiding_class);
+	check_condition(objc_object_set_variable_named(instance, "i", &i_value) == &_IvarHidingClass_i_ivar_, "ivars - setting a hiding ivar");
+	check_condition(objc_object_get_variable_named(instance, "i", &value) == &_IvarHidingClass_i_ivar_ && out_value == 7, "ivars - getting a hiding ivar");
+	check_condition(*(int*)objc_object_get_variable(instance, &_MyClass_isa_i_ivar_) == 0, "ivars - the hidden ivar is untouched");
+	objc_object_deallocate(instance);
+}
+
+/*
+ * Checks the offsets given to mixed ivars by the ivar layout optimization:
+ * the hot ones come right after isa, then the rest, each group ordered
+ * by decreasing alignment. Assumes 8-byte pointers.
+ */
+static void check_ivar_layout(void){
+	Class cl = objc_class_create(Nil, "IvarLayoutClass");
+	Ivar c1, d, c2, i, p;
+	char char_value = 'a';
+	double double_value = 0.5;
+	int int_value = 42;
+	void *pointer_value = &char_value;
+	id instance;
+	
+	objc_class_add_ivar(cl, "isa", sizeof(Class), __alignof(Class), "#");
+	c1 = objc_class_add_ivar(cl, "c1", sizeof(char), __alignof(char), "c");
+	d = objc_class_add_ivar(cl, "d", sizeof(double), 8, "d");
+	c2 = objc_class_add_ivar(cl, "c2", sizeof(char), __alignof(char), "c");
+	i = objc_class_add_ivar(cl, "i", sizeof(int), __alignof(int), "i");
+	p = objc_class_add_ivar(cl, "p", sizeof(void*), __alignof(void*), "^v");
+	objc_class_set_ivar_hot(cl, "c2", YES);
+	objc_class_set_ivar_hot(cl, "i", YES);
+	objc_class_set_optimizes_ivar_layout(cl, YES);
+	objc_class_finish(cl);
+	
+	/* Hot: i, c2; the rest: d, p, c1. */
+	if (i->offset != 8 || c2->offset != 12 || d->offset != 16 || p->offset != 24 || c1->offset != 32
+	    || objc_class_instance_size(cl) != 40){
+		printf("Correctness condition false for ivar layout - offsets i %u c2 %u d %u p %u c1 %u, size %u!\n",
+		       i->offset, c2->offset, d->offset, p->offset, c1->offset, objc_class_instance_size(cl));
+		objc_abort("");
+	}
+	
+	instance = objc_class_create_instance(cl);
+	objc_object_set_variable(instance, c1, &char_value);
+	objc_object_set_variable(instance, d, &double_value);
+	objc_object_set_variable(instance, c2, &char_value);
+	objc_object_set_variable(instance, i, &int_value);
+	objc_object_set_variable(instance, p, &pointer_value);
+	if (*(char*)objc_object_get_variable(instance, c1) != 'a' || *(double*)objc_object_get_variable(instance, d) != 0.5
+	    || *(char*)objc_object_get_variable(instance, c2) != 'a' || *(int*)objc_object_get_variable(instance, i) != 42
+	    || *(void**)objc_object_get_variable(instance, p) != &char_value || instance->isa != cl){
+		printf("Correctness condition false for ivar layout - values!\n");
+		objc_abort("");
+	}
+	objc_object_deallocate(instance);
+}
+
 int main(int argc, const char * argv[]){
 	register_classes();
+	check_ivar_layout();
+	check_typed_accessors();
+	check_ivar_index();
+	
+	printf("Getters and setters:\n");
 	perform_tests(ivar_test);
+	
+	printf("Typed accessors:\n");
+	perform_tests(typed_ivar_test);
 	return 0;
 }
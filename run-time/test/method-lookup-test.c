@@ -0,0 +1,94 @@
+#include "testing.h"
+
+/*
+ * Compares looking up methods in the sorted method table of a finished
+ * class with looking them up in the method list, which is what is done
+ * while a class is in construction. Each lookup is a cache miss, just
+ * like objc_class_responds_to_instance_selector.
+ */
+
+#define LOOKUP_METHOD_COUNT 256
+#define LOOKUP_SELECTOR_COUNT (LOOKUP_METHOD_COUNT * 2)
+
+/* A multiple of LOOKUP_SELECTOR_COUNT, so that exactly half are misses. */
+#define LOOKUP_ITERATIONS ((DISPATCH_ITERATIONS / 100 / LOOKUP_SELECTOR_COUNT) * LOOKUP_SELECTOR_COUNT)
+
+static SEL lookup_selectors[LOOKUP_SELECTOR_COUNT];
+
+/* A class in construction can't be looked up by name. */
+static Class lookup_table_class;
+static Class lookup_list_class;
+
+static void _I_LookupClass_method_(id self, SEL _cmd, ...){
+}
+
+static Class create_lookup_class(const char *name, BOOL finish){
+	Class cl = objc_class_create(Nil, name);
+	int i;
+
+	objc_class_add_ivar(cl, "isa", sizeof(Class), __alignof(Class), "#");
+	for (i = 0; i < LOOKUP_METHOD_COUNT; ++i){
+		objc_class_add_instance_method(cl, objc_method_create(lookup_selectors[i], "v@:", (IMP)_I_LookupClass_method_));
+	}
+
+	if (finish){
+		objc_class_finish(cl);
+	}
+	return cl;
+}
+
+static void register_lookup_classes(void){
+	char name[32];
+	int i;
+
+	/* The second half are selectors the classes don't respond to. */
+	for (i = 0; i < LOOKUP_SELECTOR_COUNT; ++i){
+		sprintf(name, "lookupMethod%i", i);
+		lookup_selectors[i] = objc_selector_register(name);
+	}
+
+	lookup_table_class = create_lookup_class("LookupTableClass", YES);
+	lookup_list_class = create_lookup_class("LookupListClass", NO);
+}
+
+static clock_t lookup_test(Class cl){
+	unsigned int found = 0;
+	clock_t c1, c2;
+	int i;
+
+	c1 = clock();
+	for (i = 0; i < LOOKUP_ITERATIONS; ++i){
+		/* Half of the lookups are misses. */
+		if (objc_class_responds_to_instance_selector(cl, lookup_selectors[(i * 7) % LOOKUP_SELECTOR_COUNT])){
+			++found;
+		}
+	}
+	c2 = clock();
+
+	if (found != LOOKUP_ITERATIONS / 2){
+		printf("Correctness condition false for test lookup in %s!\n", objc_class_get_name(cl));
+		objc_abort("");
+	}
+
+	return (c2 - c1);
+}
+
+static clock_t table_lookup_test(void){
+	return lookup_test(lookup_table_class);
+}
+
+static clock_t list_lookup_test(void){
+	return lookup_test(lookup_list_class);
+}
+
+int main(int argc, const char * argv[]){
+	register_classes();
+	register_lookup_classes();
+
+	printf("Method table:\n");
+	perform_tests(table_lookup_test);
+
+	printf("Method list:\n");
+	perform_tests(list_lookup_test);
+	return 0;
+}
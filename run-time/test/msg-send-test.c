@@ -0,0 +1,15 @@
+#include "testing.h"
+
+GENERATE_TEST(msg_send, "MySubclass", {}, DISPATCH_ITERATIONS, {
+	static SEL selector = NULL;
+	if (selector == NULL){
+		selector = objc_selector_register("increment");
+	}
+	objc_msg_send((id)instance, selector);
+}, (*((int*)(objc_object_get_variable((id)instance, objc_class_get_ivar(objc_class_for_name("MySubclass"), "i")))) == DISPATCH_ITERATIONS))
+
+int main(int argc, const char * argv[]){
+	register_classes();
+	perform_tests(msg_send_test);
+	return 0;
+}
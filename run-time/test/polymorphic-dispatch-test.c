@@ -0,0 +1,20 @@
+#include "testing.h"
+
+/* Every other message goes to an instance of another class. */
+static MyClass *other_instance;
+
+GENERATE_TEST(polymorphic_dispatch, "MySubclass", {
+	other_instance = (MyClass*)objc_class_create_instance(objc_class_for_name("MyClass"));
+}, DISPATCH_ITERATIONS, {
+	SEL selector = NULL;
+	IMP impl = NULL;
+	MyClass *receiver = (i & 1) ? other_instance : instance;
+	OBJC_GET_IMP((id)receiver, "increment", selector, impl);
+	impl((id)receiver, selector);
+}, (instance->i == DISPATCH_ITERATIONS / 2 && other_instance->i == DISPATCH_ITERATIONS / 2))
+
+int main(int argc, const char * argv[]){
+	register_classes();
+	perform_tests(polymorphic_dispatch_test);
+	return 0;
+}
@@ -0,0 +1,87 @@
+#include "testing.h"
+#include "../classes/MRObjects.h"
+
+/*
+ * Compares creating a graph of objects and deallocating them one by one
+ * with creating them in a region and popping it.
+ */
+
+#define REGION_OBJECT_COUNT 1000
+#define REGION_ITERATIONS (ALLOCATION_ITERATIONS / REGION_OBJECT_COUNT)
+
+static id region_objects[REGION_OBJECT_COUNT];
+
+static clock_t deallocation_test(void){
+	Class cl = objc_class_for_name("MyClass");
+	clock_t c1, c2;
+	int i, o;
+	
+	c1 = clock();
+	for (i = 0; i < REGION_ITERATIONS; ++i){
+		for (o = 0; o < REGION_OBJECT_COUNT; ++o){
+			region_objects[o] = objc_class_create_instance(cl);
+		}
+		for (o = 0; o < REGION_OBJECT_COUNT; ++o){
+			objc_object_deallocate(region_objects[o]);
+		}
+	}
+	c2 = clock();
+	
+	if (objc_region_contains_object(region_objects[0])){
+		printf("Correctness condition false for test deallocation!\n");
+		objc_abort("");
+	}
+	
+	return (c2 - c1);
+}
+
+static clock_t region_test(void){
+	Class cl = objc_class_for_name("MyClass");
+	SEL retain_selector = objc_selector_register("retain");
+	SEL release_selector = objc_selector_register("release");
+	unsigned int destructed_before = destructed_object_count;
+	BOOL contained = YES;
+	BOOL retain_count_kept = YES;
+	clock_t c1, c2;
+	int i, o;
+	
+	c1 = clock();
+	for (i = 0; i < REGION_ITERATIONS; ++i){
+		objc_region_push();
+		for (o = 0; o < REGION_OBJECT_COUNT; ++o){
+			region_objects[o] = objc_class_create_instance(cl);
+		}
+		contained = contained && objc_region_contains_object(region_objects[REGION_OBJECT_COUNT - 1]);
+		
+		/* Retain and release are no-ops, the object lives until the pop. */
+		((id(*)(id, SEL))objc_object_lookup_impl(region_objects[0], retain_selector))(region_objects[0], retain_selector);
+		((void(*)(id, SEL))objc_object_lookup_impl(region_objects[0], release_selector))(region_objects[0], release_selector);
+		((void(*)(id, SEL))objc_object_lookup_impl(region_objects[0], release_selector))(region_objects[0], release_selector);
+		retain_count_kept = retain_count_kept && ((MRObject_instance_t*)region_objects[0])->retainCount == 0;
+		
+		/* Deallocated instances mustn't be finalized again by the pop. */
+		objc_object_deallocate(region_objects[1]);
+		objc_region_pop();
+	}
+	c2 = clock();
+	
+	if (!contained || !retain_count_kept || objc_region_contains_object(region_objects[0])
+	    || destructed_object_count - destructed_before != REGION_ITERATIONS * REGION_OBJECT_COUNT){
+		printf("Correctness condition false for test region!\n");
+		objc_abort("");
+	}
+	
+	return (c2 - c1);
+}
+
+int main(int argc, const char * argv[]){
+	register_counting_extension();
+	register_classes();
+	
+	printf("Deallocation:\n");
+	perform_tests(deallocation_test);
+	
+	printf("Region:\n");
+	perform_tests(region_test);
+	return 0;
+}
@@ -0,0 +1,86 @@
+#include "testing.h"
+#include <string.h>
+
+/*
+ * Compares registering selectors one by one with registering them
+ * at once, after checking that both give the same selectors, including
+ * names repeated within a single call.
+ */
+
+#define SELECTOR_NAME_COUNT 1024
+#define SELECTOR_ITERATIONS (DISPATCH_ITERATIONS / 100 / SELECTOR_NAME_COUNT)
+
+static char selector_name_buffer[SELECTOR_NAME_COUNT][32];
+static const char *selector_names[SELECTOR_NAME_COUNT];
+static SEL selectors[SELECTOR_NAME_COUNT];
+
+static void check_register_many(void){
+	const char *names[] = {
+		"duplicateSelector", "otherSelector", "duplicateSelector", "increment", "duplicateSelector", "otherSelector"
+	};
+	SEL out[6];
+	int i;
+
+	objc_selector_register_many(names, out, 6);
+
+	for (i = 0; i < 6; ++i){
+		check_condition(out[i] != NULL && strcmp(objc_selector_get_name(out[i]), names[i]) == 0, "selectors - selector names");
+		check_condition(objc_selector_register(names[i]) == out[i], "selectors - same selectors as when registered one by one");
+	}
+
+	check_condition(out[0] == out[2] && out[0] == out[4] && out[1] == out[5], "selectors - names repeated within a call");
+	check_condition(out[0] != out[1] && out[0]->index != out[1]->index, "selectors - distinct names");
+}
+
+static clock_t register_test(BOOL bulk){
+	clock_t c1, c2;
+	int i, o;
+
+	c1 = clock();
+	for (i = 0; i < SELECTOR_ITERATIONS; ++i){
+		if (bulk){
+			objc_selector_register_many(selector_names, selectors, SELECTOR_NAME_COUNT);
+		}else{
+			for (o = 0; o < SELECTOR_NAME_COUNT; ++o){
+				selectors[o] = objc_selector_register(selector_names[o]);
+			}
+		}
+	}
+	c2 = clock();
+
+	for (o = 0; o < SELECTOR_NAME_COUNT; ++o){
+		if (selectors[o] == NULL || strcmp(objc_selector_get_name(selectors[o]), selector_names[o]) != 0){
+			printf("Correctness condition false for test selector registration!\n");
+			objc_abort("");
+		}
+	}
+
+	return (c2 - c1);
+}
+
+static clock_t one_by_one_register_test(void){
+	return register_test(NO);
+}
+
+static clock_t bulk_register_test(void){
+	return register_test(YES);
+}
+
+int main(int argc, const char * argv[]){
+	int i;
+
+	register_classes();
+	check_register_many();
+
+	for (i = 0; i < SELECTOR_NAME_COUNT; ++i){
+		sprintf(selector_name_buffer[i], "selectorTestMethod%i:", i);
+		selector_names[i] = selector_name_buffer[i];
+	}
+
+	printf("One by one:\n");
+	perform_tests(one_by_one_register_test);
+
+	printf("Bulk:\n");
+	perform_tests(bulk_register_test);
+	return 0;
+}
@@ -0,0 +1,115 @@
+#include "testing.h"
+
+/*
+ * Compares objc_class_is_subclass_of, which uses the ancestor display
+ * of the class, with walking the superclasses, after checking it against
+ * the walk for all pairs of classes of a hierarchy.
+ */
+
+#define SUBCLASS_DEPTH 8
+#define SUBCLASS_ITERATIONS (DISPATCH_ITERATIONS / 10)
+
+/* The chain of subclasses of MySubclass, the last one being the deepest. */
+static Class subclass_chain[SUBCLASS_DEPTH];
+static Class unrelated_class;
+
+static BOOL is_subclass_by_walking(Class cl, Class candidate){
+	while (cl != Nil){
+		if (cl == candidate){
+			return YES;
+		}
+		cl = objc_class_get_superclass(cl);
+	}
+	return NO;
+}
+
+static void register_subclass_classes(void){
+	Class superclass = objc_class_for_name("MySubclass");
+	char name[32];
+	int i;
+
+	for (i = 0; i < SUBCLASS_DEPTH; ++i){
+		sprintf(name, "MySubclass%i", i);
+		subclass_chain[i] = objc_class_create(superclass, name);
+		objc_class_finish(subclass_chain[i]);
+		superclass = subclass_chain[i];
+	}
+
+	unrelated_class = objc_class_create(Nil, "UnrelatedClass");
+	objc_class_add_ivar(unrelated_class, "isa", sizeof(Class), __alignof(Class), "#");
+	objc_class_finish(unrelated_class);
+}
+
+static void check_is_subclass_of(void){
+	Class deepest = subclass_chain[SUBCLASS_DEPTH - 1];
+	Class root = objc_class_for_name("MRObject");
+	Class all[SUBCLASS_DEPTH + 4];
+	int count = 0;
+	int i, o;
+
+	check_condition(objc_class_is_subclass_of(deepest, deepest), "subclass - the class itself");
+	check_condition(objc_class_is_subclass_of(deepest, subclass_chain[SUBCLASS_DEPTH - 2]), "subclass - the direct superclass");
+	check_condition(objc_class_is_subclass_of(deepest, root), "subclass - a deep ancestor");
+	check_condition(!objc_class_is_subclass_of(deepest, unrelated_class), "subclass - an unrelated class");
+	check_condition(!objc_class_is_subclass_of(unrelated_class, root), "subclass - an unrelated root class");
+	check_condition(!objc_class_is_subclass_of(subclass_chain[0], deepest), "subclass - a candidate deeper than the class");
+	check_condition(!objc_class_is_subclass_of(root, deepest), "subclass - a root class and a deep candidate");
+
+	all[count++] = root;
+	all[count++] = objc_class_for_name("MyClass");
+	all[count++] = objc_class_for_name("MySubclass");
+	for (i = 0; i < SUBCLASS_DEPTH; ++i){
+		all[count++] = subclass_chain[i];
+	}
+	all[count++] = unrelated_class;
+
+	for (i = 0; i < count; ++i){
+		for (o = 0; o < count; ++o){
+			check_condition(objc_class_is_subclass_of(all[i], all[o]) == is_subclass_by_walking(all[i], all[o]), "subclass - a pair of classes");
+		}
+	}
+}
+
+static clock_t subclass_test(BOOL(*is_subclass)(Class, Class)){
+	Class root = objc_class_for_name("MRObject");
+	unsigned int found = 0;
+	clock_t c1, c2;
+	int i;
+
+	c1 = clock();
+	for (i = 0; i < SUBCLASS_ITERATIONS; ++i){
+		/* Half of the tests are misses. */
+		if (is_subclass(subclass_chain[SUBCLASS_DEPTH - 1], (i % 2 == 0) ? root : unrelated_class)){
+			++found;
+		}
+	}
+	c2 = clock();
+
+	if (found != SUBCLASS_ITERATIONS / 2){
+		printf("Correctness condition false for test subclass!\n");
+		objc_abort("");
+	}
+
+	return (c2 - c1);
+}
+
+static clock_t display_subclass_test(void){
+	return subclass_test(objc_class_is_subclass_of);
+}
+
+static clock_t walking_subclass_test(void){
+	return subclass_test(is_subclass_by_walking);
+}
+
+int main(int argc, const char * argv[]){
+	register_classes();
+	register_subclass_classes();
+	check_is_subclass_of();
+
+	printf("Ancestor display:\n");
+	perform_tests(display_subclass_test);
+
+	printf("Walking the superclasses:\n");
+	perform_tests(walking_subclass_test);
+	return 0;
+}
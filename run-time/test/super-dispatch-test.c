@@ -7,15 +7,42 @@ GENERATE_TEST(super_dispatch, "MySubclass", {}, DISPATCH_ITERATIONS, {
 	impl((id)instance, selector);
 }, (*((int*)(objc_object_get_variable((id)instance, objc_class_get_ivar(objc_class_for_name("MySubclass"), "i")))) == 2 * DISPATCH_ITERATIONS))
 
+/*
+ * Checks that the cache of MySubclass, created when increment is already
+ * cached in MyClass (some caches are derived from the superclass' one),
+ * holds the override. The call site caches would hide a wrong entry,
+ * hence the method is looked up directly, twice - first when creating
+ * the cache and then in it.
+ */
+static void check_overridden_method(void){
+	SEL selector = objc_selector_register("increment");
+	id instance = objc_class_create_instance(objc_class_for_name("MySubclass"));
+	int i;
+	
+	for (i = 0; i < 2; ++i){
+		check_condition(objc_object_lookup_impl(instance, selector) == (IMP)_I_MySubclass_increment_, "test super_dispatch - overridden method");
+	}
+	
+	objc_object_deallocate(instance);
+}
+
 int main(int argc, const char * argv[]){
 	register_classes();
 	
+	{
+		id instance = objc_class_create_instance(objc_class_for_name("MyClass"));
+		objc_object_lookup_impl(instance, objc_selector_register("increment"));
+		objc_object_deallocate(instance);
+	}
+	
 	{
 		Method m = (Method)&_I_MySubclass_increment_mp_;
 		m->selector = objc_selector_register(_I_MySubclass_increment_mp_.selector_name);
 		objc_class_add_instance_method(objc_class_for_name("MySubclass"), m);
 	}
 	
+	check_overridden_method();
+	
 	perform_tests(super_dispatch_test);
 	return 0;
 }
@@ -15,6 +15,14 @@
 	#include "../extras/categs.h"
 #endif
 
+#if OBJC_HAS_SLAB_EXTENSION
+	#include "../extras/slab-ext.h"
+#endif
+
+#if OBJC_HAS_REGION_EXTENSION
+	#include "../extras/region-ext.h"
+#endif
+
 typedef struct {
 	Class isa;
 	id proxyObject;
@@ -218,12 +226,28 @@ static struct objc_category_prototype _MyClass_Privates_category_prototype_ = {
 
 
 static void register_classes(void){
+	#if OBJC_SPARSE_DISPATCH_TABLES && !OBJC_USES_INLINE_FUNCTIONS
+	{
+		/* Benchmark the sparse dispatch tables instead of the default cache. */
+		objc_runtime_setup_t setup;
+		objc_runtime_get_setup(&setup);
+		objc_runtime_setup_sparse_dispatch_tables(&setup);
+		objc_runtime_set_setup(&setup);
+	}
+	#endif
+	
 	#if OBJC_HAS_AO_EXTENSION
 		objc_associated_object_register_extension();
 	#endif
 	#if OBJC_HAS_CATEGORIES_EXTENSION
 		objc_categories_register_extension();
 	#endif
+	#if OBJC_HAS_SLAB_EXTENSION
+		objc_slab_allocator_register_extension();
+	#endif
+	#if OBJC_HAS_REGION_EXTENSION
+		objc_region_register_extension();
+	#endif
 	
 	objc_class_register_prototype(&MyClass_class);
 	objc_class_register_prototype(&MySubclass_class);
@@ -233,6 +257,44 @@ static void register_classes(void){
 #endif
 }
 
+/**
+ * Aborts the test, naming the check what, unless condition holds.
+ */
+static void check_condition(BOOL condition, const char *what){
+	if (!condition){
+		printf("Correctness condition false for %s!\n", what);
+		objc_abort("");
+	}
+}
+
+/**
+ * An extension counting the destructed instances, so that tests
+ * deallocating objects in bulk can check each was finalized once.
+ */
+static objc_class_extension counting_extension;
+static unsigned int destructed_object_count;
+
+static void _counting_object_destructor(id obj, void *extra_space){
+	++destructed_object_count;
+}
+
+static void register_counting_extension(void){
+	counting_extension.object_allocator_for_class = NULL;
+	counting_extension.object_deallocator_for_object = NULL;
+	counting_extension.object_has_managed_lifetime = NULL;
+	counting_extension.class_initializer = NULL;
+	counting_extension.class_lookup_function = NULL;
+	counting_extension.class_methods_function = NULL;
+	counting_extension.extra_class_space = 0;
+	counting_extension.extra_object_space = 0;
+	counting_extension.instance_lookup_function = NULL;
+	counting_extension.instance_methods_function = NULL;
+	counting_extension.object_destructor = _counting_object_destructor;
+	counting_extension.object_initializer = NULL;
+	
+	objc_class_add_extension(&counting_extension);
+}
+
 static void print_method_list(Method *methods){
 	while (*methods != NULL){
 		printf("\t%s - %p\n", (*methods)->selector->name, (*methods)->implementation);
@@ -317,27 +379,13 @@ static void list_classes(void){
 #elif OBJC_INLINE_CACHING == OBJC_INLINE_CACHING_COMPLETE
 #define OBJC_GET_IMP(obj, sel_name, sel_var, imp_var) {\
 	static SEL sel_var##sel_var;\
-	static struct {\
-		Method m;\
-		Class isa;\
-		unsigned int version;\
-	} cache;\
+	static objc_call_site_cache cache;\
 	\
 	if (sel_var##sel_var == NULL){\
 		sel_var##sel_var = objc_selector_register(sel_name);\
 	}\
 	sel_var = sel_var##sel_var;\
-	\
-	if (cache.m == NULL || \
-		(((id)obj)->isa != cache.isa || cache.version != cache.m->version)\
-		){\
-		cache.m = objc_object_lookup_method(obj, sel_var##sel_var);\
-		cache.version = cache.m->version;\
-		cache.isa = ((id)obj)->isa;\
-		imp_var = cache.m->implementation;\
-	}else{\
-		imp_var = cache.m->implementation;\
-	}\
+	imp_var = objc_call_site_lookup_impl(&cache, (id)(obj), sel_var);\
 }
 #else
 #error Unknown type of caching.
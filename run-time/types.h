@@ -22,9 +22,17 @@ typedef signed char BOOL;
 
 typedef struct objc_class *Class;
 
-/* A definition of a SEL. */
+/**
+ * A definition of a SEL. There is exactly one SEL per name, so selectors
+ * may be compared by pointer. The index is assigned by the run-time
+ * when the selector is registered - selectors are numbered densely
+ * from 0, so the index may be used to index arrays (see the sparse
+ * dispatch tables). Only a registration that loses a race to another
+ * thread leaves an index unused.
+ */
 typedef struct objc_selector {
 	const char *name;
+	unsigned int index;
 } *SEL;
 
 /**
@@ -50,6 +58,10 @@ typedef id(*IMP)(id target, SEL _cmd, ...);
 
 /**
  * Declaration of a Method.
+ *
+ * The version is left for the use of the caller - the run-time
+ * doesn't modify it. To find out whether a looked up IMP may be
+ * stale, use objc_dispatch_get_generation() (see callsite.h).
  */
 typedef struct objc_method {
 	SEL selector;
@@ -78,6 +90,13 @@ typedef struct objc_ivar {
 	const char *type;
 	unsigned int size;
 	unsigned int offset;
+	
+	/*
+	 * Filled by objc_class_add_ivar, may be omitted in prototypes,
+	 * the offsets of which are fixed.
+	 */
+	unsigned int alignment;
+	BOOL hot; /* See objc_class_set_ivar_hot */
 } *Ivar;
 
 /**
@@ -109,23 +128,62 @@ typedef void *objc_selector_holder;
  */
 typedef void *objc_cache;
 
+/**
+ * Statistics of a cache, as reported by the cache implementation.
+ *
+ * slot_count - number of slots the cache has allocated.
+ * entry_count - number of cached methods.
+ * resize_count - number of times the cache has grown.
+ * max_probe_length - the largest number of slots a lookup
+ *			of a cached selector needs to visit.
+ * total_probe_length - sum of the probe lengths of all cached
+ *			selectors. Divide by entry_count to get the average.
+ */
+typedef struct {
+	unsigned int slot_count;
+	unsigned int entry_count;
+	unsigned int resize_count;
+	unsigned int max_probe_length;
+	unsigned int total_probe_length;
+} objc_cache_statistics;
+
+/**
+ * Number of (class, IMP) pairs a call-site cache can hold.
+ */
+#define OBJC_CALL_SITE_CACHE_SIZE 4
+
+/**
+ * A polymorphic inline cache of a single call site - see callsite.h.
+ * The fields are private, the structure only needs to be zeroed
+ * (e.g. declared static) before its first use.
+ *
+ * sequence - odd while the cache is being updated.
+ * generation - dispatch generation the entries are valid in.
+ * count - number of valid entries, or OBJC_CALL_SITE_MEGAMORPHIC
+ *			if the site has seen too many classes.
+ * entries - the classes of the receivers and the IMPs.
+ */
+typedef struct {
+	unsigned int sequence;
+	unsigned int generation;
+	unsigned int count;
+	struct {
+		Class isa;
+		IMP implementation;
+	} entries[OBJC_CALL_SITE_CACHE_SIZE];
+} objc_call_site_cache;
+
 /**
  * A definition for a dynamically growing array structure. The easiest
  * implementation is to create a structure which includes a counter of objects,
  * size of the array, and a dynamically allocated C-array of inserted pointers.
  * It is used to keep arrays of methods, protocols, etc. on a class.
  * This run-time provides a default implementation of such an array.
+ *
+ * The items are read as a contiguous C-array, see objc_array_items_getter_f.
  */
 typedef void *objc_array;
 
-/**
- * An enumerator structure returned by the array.
- */
-typedef struct _objc_array_enumerator {
-	struct _objc_array_enumerator *next;
-	void *item;
-} *objc_array_enumerator;
-
 /* A definition for a read/write lock. */
 typedef void *objc_rw_lock;
 
@@ -155,9 +213,65 @@ struct objc_class {
 	unsigned int version; /** Right now 0. */
 	struct {
 		BOOL in_construction : 1;
+		BOOL eager_dispatch : 1; /* See objc_class_set_eager_dispatch */
+		BOOL optimizes_ivar_layout : 1; /* See objc_class_set_optimizes_ivar_layout */
 	} flags;
 	
 	void *extra_space;
+	
+	/*
+	 * Outcomes of forwarding - the Method returned by forwarding,
+	 * or the nil-receiver method in case the message is dropped.
+	 * Kept apart from the caches above so that the regular lookup
+	 * functions don't return forwarded methods.
+	 */
+	objc_cache class_forwarding_cache;
+	objc_cache instance_forwarding_cache;
+	
+	/*
+	 * Subclass tree - the first direct subclass and the next
+	 * class sharing the same superclass. Maintained by the run-time
+	 * so that flushing caches of subclasses only visits the subtree.
+	 */
+	Class first_subclass;
+	Class next_sibling;
+	
+	/*
+	 * The methods of the class sorted by selector, built when the class
+	 * gets finished (or its prototype registered) and kept up to date
+	 * as methods are added. NULL while the class is in construction.
+	 * Private to the run-time - use the method lists above.
+	 */
+	struct objc_method_table *class_method_table;
+	struct objc_method_table *instance_method_table;
+	
+	/*
+	 * With eager dispatch, all the methods the class responds to,
+	 * including the inherited ones, sorted by selector. NULL otherwise.
+	 * Private to the run-time.
+	 */
+	struct objc_method_table *class_dispatch_table;
+	struct objc_method_table *instance_dispatch_table;
+	
+	/*
+	 * Ivars of the class and its superclasses hashed by name, built
+	 * when the class gets finished. Private to the run-time.
+	 */
+	struct objc_ivar_index *ivar_index;
+	
+	/*
+	 * Number of superclasses and the display - the chain of superclasses
+	 * from the root class down to the class itself (display[depth] is
+	 * the class), so that a subclass test is a single load.
+	 */
+	unsigned int depth;
+	Class *display;
+	
+	/*
+	 * How to allocate, initialize, finalize and deallocate instances,
+	 * built when the first instance is created. Private to the run-time.
+	 */
+	struct objc_object_plan *object_plan;
 };
 
 /** Class prototype. */
@@ -179,9 +293,37 @@ struct objc_class_prototype {
 	unsigned int version; /** Right now 0. */
 	struct {
 		BOOL in_construction : 1; /* Must be YES */
+		BOOL eager_dispatch : 1; /* Inherited from the superclass if NO */
+		BOOL optimizes_ivar_layout : 1; /* Ignored, the ivar offsets are fixed */
 	} flags;
 	
 	void *extra_space; /* Must be NULL */
+	
+	/* Forwarding cache - all pointers must be NULL, may be omitted */
+	objc_cache class_forwarding_cache;
+	objc_cache instance_forwarding_cache;
+	
+	/* Subclass tree - must be NULL, may be omitted */
+	Class first_subclass;
+	Class next_sibling;
+	
+	/* Method tables - must be NULL, may be omitted */
+	struct objc_method_table *class_method_table;
+	struct objc_method_table *instance_method_table;
+	
+	/* Dispatch tables - must be NULL, may be omitted */
+	struct objc_method_table *class_dispatch_table;
+	struct objc_method_table *instance_dispatch_table;
+	
+	/* Ivar index - must be NULL, may be omitted */
+	struct objc_ivar_index *ivar_index;
+	
+	/* Display - will be filled, display must be NULL, may be omitted */
+	unsigned int depth;
+	Class *display;
+	
+	/* Object plan - must be NULL, may be omitted */
+	struct objc_object_plan *object_plan;
 };
 
 #endif /* OBJC_TYPES_H_ */
@@ -88,39 +88,95 @@ OBJC_INLINE BOOL objc_strings_equal(const char *str1, const char *str2){
 }
 
 /*
- * Hashes string str.
+ * The MurmurHash3 finalizer - mixes all bits of hash into the low bits.
  */
-OBJC_INLINE unsigned int objc_hash_string(const char *str) OBJC_ALWAYS_INLINE;
-OBJC_INLINE unsigned int objc_hash_string(const char *str){
-	register unsigned int hash = 0;
-	register unsigned char *s = (unsigned char *)str;
+OBJC_INLINE unsigned int objc_hash_finalize(unsigned int hash) OBJC_ALWAYS_INLINE;
+OBJC_INLINE unsigned int objc_hash_finalize(unsigned int hash){
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6BU;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35U;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+/*
+ * Hashes string str and stores its length into *length (unless NULL),
+ * all in a single pass. FNV-1a over the bytes followed by the MurmurHash3
+ * finalizer, so that strings sharing a long prefix (init, initWith...)
+ * still spread over the low bits used to index the tables.
+ */
+OBJC_INLINE unsigned int objc_hash_string_with_length(const char *str, unsigned int *length) OBJC_ALWAYS_INLINE;
+OBJC_INLINE unsigned int objc_hash_string_with_length(const char *str, unsigned int *length){
+	register unsigned int hash = 2166136261U;
+	register const unsigned char *s = (const unsigned char *)str;
 	
-	for (; ; ) {
-		if (*s == '\0') break;
+	while (*s != '\0'){
 		hash ^= (unsigned int)*s++;
-		if (*s == '\0') break;
-		hash ^= (unsigned int)*s++ << 8;
-		if (*s == '\0') break;
-		hash ^= (unsigned int)*s++ << 16;
-		if (*s == '\0') break;
-		hash ^= (unsigned int)*s++ << 24;
+		hash *= 16777619U;
 	}
-	return hash;
+	
+	if (length != NULL){
+		*length = (unsigned int)(s - (const unsigned char *)str);
+	}
+	return objc_hash_finalize(hash);
 }
 
 /*
- * Copies memory from source to destination.
+ * Hashes string str.
+ */
+OBJC_INLINE unsigned int objc_hash_string(const char *str) OBJC_ALWAYS_INLINE;
+OBJC_INLINE unsigned int objc_hash_string(const char *str){
+	return objc_hash_string_with_length(str, NULL);
+}
+
+/*
+ * Hashes a pointer. The low bits are discarded as they are
+ * mostly zero due to alignment, the rest of the bits are mixed
+ * so that masking the result with a power-of-two mask yields
+ * a well-distributed index.
+ */
+OBJC_INLINE unsigned int objc_hash_pointer(const void *ptr) OBJC_ALWAYS_INLINE;
+OBJC_INLINE unsigned int objc_hash_pointer(const void *ptr){
+	register unsigned long hash = (unsigned long)ptr >> 3;
+
+	hash ^= hash >> 17;
+	hash *= 0x9E3779B1UL;
+	hash ^= hash >> 15;
+	return (unsigned int)hash;
+}
+
+/*
+ * A machine word that may alias any other type, so that memory
+ * may be copied word by word.
+ */
+#if defined(__GNUC__)
+	typedef unsigned long __attribute__((__may_alias__)) objc_memory_word;
+#else
+	typedef unsigned long objc_memory_word;
+#endif
+
+/*
+ * Copies memory from source to destination. If both are
+ * word-aligned (ivars and the values passed for them mostly are),
+ * whole words are copied and only the rest byte by byte.
  */
 OBJC_INLINE void objc_copy_memory(void *src, void *dst, unsigned int size) OBJC_ALWAYS_INLINE;
 OBJC_INLINE void objc_copy_memory(void *src, void *dst, unsigned int size){
 	const char *src_ptr;
 	char *dest_ptr;
-	unsigned int i;
+	unsigned int i = 0;
 	
 	src_ptr = (const char*)src;
 	dest_ptr = (char*)dst;
 	
-	for (i = 0; i < size; ++i){
+	if ((((unsigned long)src_ptr | (unsigned long)dest_ptr) & (sizeof(objc_memory_word) - 1)) == 0){
+		for ( ; i + sizeof(objc_memory_word) <= size; i += sizeof(objc_memory_word)){
+			*(objc_memory_word*)(dest_ptr + i) = *(const objc_memory_word*)(src_ptr + i);
+		}
+	}
+	
+	for ( ; i < size; ++i){
 		dest_ptr[i] = src_ptr[i];
 	}
 }